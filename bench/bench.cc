@@ -0,0 +1,61 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+volatile long long bench::sink;
+
+namespace {
+   std::atomic<long long> num_allocations(0);
+}
+
+// Every allocation in the program goes through these, so they can be counted
+void *operator new(size_t size) {
+   num_allocations.fetch_add(1, std::memory_order_relaxed);
+   void *p = std::malloc(size ? size : 1);
+   if (!p) throw std::bad_alloc();
+   return p;
+}
+
+void *operator new[](size_t size) {
+   return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+   std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+   std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+   std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+   std::free(p);
+}
+
+long long bench::allocations() {
+   return num_allocations.load(std::memory_order_relaxed);
+}
+
+long bench::peak_rss_kb() {
+#ifdef _WIN32
+   return 0;
+#else
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+   return usage.ru_maxrss;
+#endif
+#endif
+}
@@ -0,0 +1,41 @@
+#ifndef CTOML_BENCH_BENCH_H_
+#define CTOML_BENCH_BENCH_H_
+
+#include <chrono>
+#include <cstdio>
+
+namespace bench {
+   // Results are folded into this so the work cannot be optimised away
+   extern volatile long long sink;
+
+   // Number of times operator new has been called so far
+   long long allocations();
+
+   // Peak resident set size of the whole process so far, in kilobytes (0 where
+   // it cannot be measured)
+   long peak_rss_kb();
+
+   // Runs fn (which performs ops operations) until at least min_ms milliseconds
+   // have passed and returns the average nanoseconds per operation
+   template <class F>
+   double time_ns(F fn, long long ops, double min_ms = 200.0) {
+      typedef std::chrono::steady_clock clock;
+
+      long long runs = 0;
+      auto start = clock::now();
+      double elapsed_ms = 0;
+      do {
+         fn();
+         runs++;
+         elapsed_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+      } while (elapsed_ms < min_ms);
+
+      return elapsed_ms * 1e6 / (runs * ops);
+   }
+
+   inline void report(const char *name, double ns_per_op) {
+      printf("%-48s %12.2f ns/op\n", name, ns_per_op);
+   }
+}
+
+#endif
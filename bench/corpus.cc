@@ -0,0 +1,139 @@
+#include "corpus.h"
+
+#include <cstdio>
+#include <random>
+
+std::string bench::make_int_document(int num_groups, int num_keys, int array_size) {
+   std::string src = "numbers = [";
+   for (int i = 0; i < array_size; i++) {
+      if (i) src += ", ";
+      src += std::to_string(i * 7 - 1000);
+   }
+   src += "]\n";
+
+   for (int g = 0; g < num_groups; g++) {
+      src += "[group" + std::to_string(g) + "]\n";
+      for (int k = 0; k < num_keys; k++) {
+         src += "key" + std::to_string(k) + " = " + std::to_string(g * k) + "\n";
+      }
+   }
+
+   return src;
+}
+
+std::string bench::make_text_document(int num_keys) {
+   std::string src;
+   for (int i = 0; i < num_keys; i++) {
+      if (i % 50 == 0) src += "\n[section" + std::to_string(i / 50) + "]\n";
+      src += "        # A comment describing the next key, which is about as long as they get\n";
+      src += "        key" + std::to_string(i) + " = \"";
+      for (int j = 0; j < 8; j++) src += "Lorem ipsum dolor sit amet, consectetur ";
+      if (i % 10 == 0) src += "with an \\\"escape\\\"";
+      src += "\"\n";
+   }
+
+   return src;
+}
+
+std::string bench::make_number_document(int num_arrays, int array_size) {
+   std::mt19937 rng(42);
+   std::string src;
+   for (int i = 0; i < num_arrays; i++) {
+      src += (i % 2 ? "floats" : "ints") + std::to_string(i) + " = [";
+      for (int j = 0; j < array_size; j++) {
+         if (j) src += ", ";
+         long long n = static_cast<long long>(rng()) - 2147483648LL;
+         if (i % 2) src += std::to_string(n / 1000) + "." + std::to_string(rng() % 1000000);
+         else src += std::to_string(n * 1000);
+      }
+      src += "]\n";
+   }
+
+   return src;
+}
+
+std::string bench::make_datetime_document(int num_keys) {
+   std::string src;
+   for (int i = 0; i < num_keys; i++) {
+      char date[64];
+      snprintf(date, sizeof(date), "%04d-%02d-%02dT%02d:%02d:%02dZ",
+         1970 + i % 60, 1 + i % 12, 1 + i % 28, i % 24, i % 60, (i * 7) % 60);
+      src += "date" + std::to_string(i) + " = " + date + "\n";
+   }
+
+   return src;
+}
+
+std::string bench::make_deep_document(int num_groups, int depth) {
+   std::mt19937 rng(7);
+   std::string src;
+   for (int g = 0; g < num_groups; g++) {
+      // Each level picks one of four names, so groups share most of their path
+      src += "[";
+      for (int d = 0; d < depth - 1; d++) {
+         src += "d" + std::to_string(d) + "n" + std::to_string((g >> (2 * (depth - 2 - d))) & 3) + ".";
+      }
+      src += "group" + std::to_string(g) + "]\n";
+
+      src += "name = \"service-" + std::to_string(rng() % 100000) + "\"\n";
+      src += "port = " + std::to_string(1024 + rng() % 60000) + "\n";
+      src += "weight = " + std::to_string(rng() % 100) + "." + std::to_string(rng() % 100) + "\n";
+      src += "enabled = " + std::string(rng() % 2 ? "true" : "false") + "\n";
+      src += "replicas = [" + std::to_string(rng() % 8) + ", " + std::to_string(rng() % 8) + "]\n\n";
+   }
+
+   return src;
+}
+
+std::vector<std::string> bench::make_small_files(int num_files) {
+   static const char *kNames[] = { "alpha", "beta", "gamma", "delta", "epsilon", "zeta" };
+
+   std::mt19937 rng(11);
+   std::vector<std::string> files;
+   for (int f = 0; f < num_files; f++) {
+      std::string src = "# Generated configuration " + std::to_string(f) + "\n";
+      src += "title = \"" + std::string(kNames[rng() % 6]) + " service\"\n\n";
+
+      int num_groups = 2 + rng() % 4;
+      for (int g = 0; g < num_groups; g++) {
+         src += "[" + std::string(kNames[g]) + "]\n";
+         src += "host = \"10.0." + std::to_string(rng() % 256) + "." + std::to_string(rng() % 256) + "\"\n";
+         src += "port = " + std::to_string(1024 + rng() % 60000) + "\n";
+         src += "timeout = " + std::to_string(rng() % 60) + ".5\n";
+         src += "debug = " + std::string(rng() % 2 ? "true" : "false") + "\n";
+         src += "tags = [\"" + std::string(kNames[rng() % 6]) + "\", \"" + kNames[rng() % 6] + "\"]\n";
+         src += "updated = 2014-0" + std::to_string(1 + rng() % 9) + "-1" + std::to_string(rng() % 10) + "T12:00:00Z\n\n";
+      }
+
+      files.push_back(src);
+   }
+
+   return files;
+}
+
+size_t bench::Corpus::size() const {
+   size_t total = 0;
+   for (auto &file : files) total += file.size();
+   return total;
+}
+
+std::vector<bench::Corpus> bench::make_corpora() {
+   std::vector<Corpus> corpora(5);
+
+   corpora[0].name = "deep-groups";
+   corpora[0].files.push_back(make_deep_document(20000, 6));
+
+   corpora[1].name = "numeric-arrays";
+   corpora[1].files.push_back(make_number_document(200, 1000));
+
+   corpora[2].name = "escaped-strings";
+   corpora[2].files.push_back(make_text_document(10000));
+
+   corpora[3].name = "small-files";
+   corpora[3].files = make_small_files(2000);
+
+   corpora[4].name = "datetimes";
+   corpora[4].files.push_back(make_datetime_document(100000));
+
+   return corpora;
+}
@@ -0,0 +1,43 @@
+#ifndef CTOML_BENCH_CORPUS_H_
+#define CTOML_BENCH_CORPUS_H_
+
+#include <string>
+#include <vector>
+
+// Generators for synthetic TOML documents. Output only depends on the arguments
+// (std::mt19937 is fully specified by the standard), so every machine and every
+// run measures the same text.
+namespace bench {
+   // num_groups groups of num_keys integer keys, plus one large integer array
+   std::string make_int_document(int num_groups, int num_keys, int array_size);
+
+   // Long strings, some with escapes, between indented comments
+   std::string make_text_document(int num_keys);
+
+   // Large arrays of random integers and floats
+   std::string make_number_document(int num_arrays, int array_size);
+
+   // Nothing but datetimes
+   std::string make_datetime_document(int num_keys);
+
+   // num_groups key groups nested depth levels deep, sharing prefixes the way
+   // real configuration does ([d0n1.d1n3.group7]), each with a few keys of every type
+   std::string make_deep_document(int num_groups, int depth);
+
+   // Many small configuration files, of a few dozen lines each
+   std::vector<std::string> make_small_files(int num_files);
+
+   // A named set of files to benchmark
+   struct Corpus {
+      std::string name;
+      std::vector<std::string> files;
+
+      size_t size() const;
+   };
+
+   // The standard corpora: deep-groups, numeric-arrays, escaped-strings,
+   // small-files and datetimes, each a few megabytes
+   std::vector<Corpus> make_corpora();
+}
+
+#endif
@@ -0,0 +1,460 @@
+#include "../src/include/toml.h"
+#include "../src/include/tomlcompact.h"
+#include "../src/include/tomllazy.h"
+#include "../src/include/tomldiff.h"
+#include "../src/include/tomlshared.h"
+#include "../src/include/tomlwriter.h"
+#include "../src/include/tomlsnapshot.h"
+#include "../src/include/tomlschema.h"
+#include "bench.h"
+#include "corpus.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ctoml;
+using namespace bench;
+
+// bench_value_reads
+// Compares typed reads through the TomlValue class hierarchy against TomlCompactValue
+void bench_value_reads() {
+   TomlParser toml;
+   TomlDocument doc = toml.parse_buffer(make_int_document(100, 100, 100000));
+   TomlCompactDocument compact(doc);
+
+   std::vector<std::string> keys;
+   for (int g = 0; g < 100; g++) {
+      for (int k = 0; k < 100; k++) {
+         keys.push_back("group" + std::to_string(g) + ".key" + std::to_string(k));
+      }
+   }
+
+   std::vector<std::shared_ptr<TomlValue>> values;
+   std::vector<const TomlCompactValue *> compact_values;
+   for (auto &key : keys) {
+      values.push_back(doc.get(key));
+      compact_values.push_back(compact.get(key));
+   }
+
+   bench::report("TomlDocument::get_as<int64_t>", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &key : keys) sum += doc.get_as<std::int64_t>(key);
+      bench::sink = sum;
+   }, keys.size()));
+
+   bench::report("TomlDocument::get", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &key : keys) sum += doc.get(key)->type() == TomlType::Int;
+      bench::sink = sum;
+   }, keys.size()));
+
+   bench::report("TomlDocument::find", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &key : keys) sum += doc.find(key)->type() == TomlType::Int;
+      bench::sink = sum;
+   }, keys.size()));
+
+   bench::report("TomlDocument::get_as<int64_t> (literal)", bench::time_ns([&] {
+      long long sum = 0;
+      for (int i = 0; i < 1000; i++) sum += doc.get_as<std::int64_t>("group42.key17");
+      bench::sink = sum;
+   }, 1000));
+
+   std::vector<TomlKeyHandle> handles;
+   for (auto &key : keys) handles.push_back(doc.resolve(key));
+   bench::report("TomlDocument::get_as<int64_t> (handle)", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto handle : handles) sum += doc.get_as<std::int64_t>(handle);
+      bench::sink = sum;
+   }, handles.size()));
+
+   static constexpr TomlKey kKey("group42.key17");
+   bench::report("TomlDocument::get_as<int64_t> (TomlKey)", bench::time_ns([&] {
+      long long sum = 0;
+      for (int i = 0; i < 1000; i++) sum += doc.get_as<std::int64_t>(kKey);
+      bench::sink = sum;
+   }, 1000));
+
+   bench::report("TomlCompactDocument::get_as<int64_t>", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &key : keys) sum += compact.get_as<std::int64_t>(key);
+      bench::sink = sum;
+   }, keys.size()));
+
+   bench::report("toml_value_cast<int64_t> (value only)", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &value : values) sum += toml_value_cast<std::int64_t>(value);
+      bench::sink = sum;
+   }, values.size()));
+
+   bench::report("TomlCompactValue::int_value (value only)", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto value : compact_values) sum += value->int_value();
+      bench::sink = sum;
+   }, compact_values.size()));
+
+   auto array = doc.get<TomlArray>("numbers");
+   bench::report("TomlArray::at + toml_value_cast", bench::time_ns([&] {
+      long long sum = 0;
+      for (size_t i = 0; i < array->size(); i++) sum += toml_value_cast<std::int64_t>(array->at(i));
+      bench::sink = sum;
+   }, array->size()));
+
+   const TomlCompactValue &compact_array = *compact.get("numbers");
+   bench::report("TomlCompactValue array iteration", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto &value : compact_array) sum += value.int_value();
+      bench::sink = sum;
+   }, compact_array.size()));
+
+   bench::report("TomlArray::int_span iteration", bench::time_ns([&] {
+      long long sum = 0;
+      for (auto value : array->int_span()) sum += value;
+      bench::sink = sum;
+   }, array->size()));
+
+   bench::report("TomlDocument::get_array_as<int64_t>", bench::time_ns([&] {
+      bench::sink = doc.get_array_as<std::int64_t>("numbers").size();
+   }, array->size()));
+}
+
+// Builds a document dominated by long strings, comments and indentation
+// bench_shared_reads
+// Compares reads of a shared document through a Reader against taking a snapshot
+void bench_shared_reads() {
+   TomlParser toml;
+   TomlSharedDocument shared(toml.parse_buffer(make_int_document(100, 100, 0)));
+   TomlSharedDocument::Reader reader(shared);
+
+   bench::report("TomlSharedDocument::Reader::get + find", bench::time_ns([&] {
+      long long sum = 0;
+      for (int i = 0; i < 1000; i++) sum += reader.get().find("group42.key17") != nullptr;
+      bench::sink = sum;
+   }, 1000));
+
+   bench::report("TomlSharedDocument::snapshot + find", bench::time_ns([&] {
+      long long sum = 0;
+      for (int i = 0; i < 1000; i++) sum += shared.snapshot()->find("group42.key17") != nullptr;
+      bench::sink = sum;
+   }, 1000));
+}
+
+// Sums every integer in a document
+class IntSummer : public TomlHandler {
+public:
+   long long sum = 0;
+   void on_int(std::int64_t value) { sum += value; }
+};
+
+// bench_parse
+// Measures parse throughput
+void bench_parse() {
+   std::string text = make_text_document(20000);
+   std::string ints = make_int_document(100, 100, 100000);
+
+   TomlParser toml;
+   double ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(text).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (strings/comments)", text.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      auto lazy = toml.parse_buffer_lazy(text.data(), text.size());
+      bench::sink = lazy.get_as<std::string>("section7.key350").size();
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer_lazy (strings/comments)", text.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(ints).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (integers)", ints.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] { bench::sink = TomlCompactDocument(toml.parse_buffer(ints)).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlCompactDocument copy (integers)", ints.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      TomlCompactDocument compact;
+      compact.parse_buffer(toml, ints);
+      bench::sink = compact.size();
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlCompactDocument::parse_buffer (integers)", ints.size() * 1e3 / ns);
+
+   // Reload after a single value changes
+   TomlDiff diff;
+   auto previous = toml.reparse_buffer(TomlDocument(), ints.data(), ints.size(), diff);
+   std::string changed = ints;
+   changed.replace(changed.find("[group50]\nkey0 = 0"), 18, "[group50]\nkey0 = 1");
+   ns = bench::time_ns([&] {
+      bench::sink = toml.reparse_buffer(previous, changed.data(), changed.size(), diff).size();
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::reparse_buffer (integers, one change)", ints.size() * 1e3 / ns);
+
+   std::string numbers = make_number_document(200, 1000);
+   ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(numbers).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (number arrays)", numbers.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      auto lazy = toml.parse_buffer_lazy(numbers.data(), numbers.size());
+      bench::sink = lazy.get("ints0") != nullptr;
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer_lazy (number arrays)", numbers.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      IntSummer summer;
+      toml.parse_buffer(numbers, summer);
+      bench::sink = summer.sum;
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (number arrays, events)", numbers.size() * 1e3 / ns);
+
+   std::string dates = make_datetime_document(100000);
+   ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(dates).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (datetimes)", dates.size() * 1e3 / ns);
+
+   // Every line is an error
+   std::string invalid;
+   for (int i = 0; i < 100000; i++) invalid += "key" + std::to_string(i) + " = invalid # value\n";
+   ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(invalid).size() + toml.num_errors(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (invalid lines)", invalid.size() * 1e3 / ns);
+
+   toml.set_max_errors(1);
+   ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(invalid).size() + toml.num_errors(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (invalid, max_errors 1)", invalid.size() * 1e3 / ns);
+   toml.set_max_errors(0);
+}
+
+// The std::map based TomlDocument::write that TomlWriter replaced, kept for comparison
+static std::ostream &legacy_write(const TomlDocument &doc, std::ostream &out) {
+   std::map<std::string, std::shared_ptr<TomlValue>> map;
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) {
+      if (it->first.find(".") == std::string::npos) {
+         map.insert(std::make_pair("." + it->first, it->second));
+      } else {
+         map.insert(std::make_pair(it->first, it->second));
+      }
+   }
+
+   std::string prevPrefix, prefix, suffix;
+   for (auto it = map.cbegin(); it != map.cend(); ++it) {
+      std::string value = it->second->to_string();
+
+      auto pos = it->first.rfind(".");
+      if (pos != std::string::npos) {
+         prefix = it->first.substr(0, pos);
+         suffix = it->first.substr(pos + 1);
+         if (prevPrefix != prefix) out << "[" << prefix << "]" << std::endl;
+      } else {
+         prefix = "";
+         suffix = it->first;
+      }
+
+      out << suffix << " = " << value << std::endl;
+      prevPrefix = prefix;
+   }
+
+   return out;
+}
+
+// bench_write
+// Measures serialisation throughput, in bytes of output per second
+void bench_write() {
+   TomlParser toml;
+   const std::string sources[] = {
+      make_text_document(20000), make_int_document(100, 100, 0), make_number_document(200, 1000)
+   };
+   const char *names[] = { "strings", "integers", "number arrays" };
+
+   for (int i = 0; i < 3; i++) {
+      auto doc = toml.parse_buffer(sources[i]);
+
+      TomlWriter writer;
+      size_t size = writer.write(doc).size();
+
+      char name[64];
+      double ns = bench::time_ns([&] {
+         std::ostringstream out;
+         legacy_write(doc, out);
+         bench::sink = out.tellp();
+      }, 1);
+      snprintf(name, sizeof(name), "legacy write (%s)", names[i]);
+      printf("%-48s %12.2f MB/s\n", name, size * 1e3 / ns);
+
+      ns = bench::time_ns([&] {
+         std::ostringstream out;
+         doc.write(out);
+         bench::sink = out.tellp();
+      }, 1);
+      snprintf(name, sizeof(name), "TomlDocument::write (%s)", names[i]);
+      printf("%-48s %12.2f MB/s\n", name, size * 1e3 / ns);
+
+      ns = bench::time_ns([&] { bench::sink = writer.write(doc).size(); }, 1);
+      snprintf(name, sizeof(name), "TomlWriter::write, reused (%s)", names[i]);
+      printf("%-48s %12.2f MB/s\n", name, size * 1e3 / ns);
+   }
+}
+
+// bench_snapshot
+// Measures loading a document from a snapshot instead of parsing it, in MB/s of TOML
+void bench_snapshot() {
+   TomlParser toml;
+   std::string ints = make_int_document(100, 100, 100000);
+   auto doc = toml.parse_buffer(ints);
+   TomlSnapshot::save(doc, ints, "bench.snapshot");
+
+   double ns = bench::time_ns([&] { bench::sink = toml.parse_buffer(ints).size(); }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlParser::parse_buffer (integers)", ints.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      TomlSnapshot snapshot;
+      snapshot.open("bench.snapshot", ints);
+      bench::sink = snapshot.get_as<int64_t>("group50.key7");
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlSnapshot::open + get (integers)", ints.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      TomlSnapshot snapshot;
+      snapshot.open("bench.snapshot", ints);
+      bench::sink = snapshot.to_document().size();
+   }, 1);
+   printf("%-48s %12.2f MB/s\n", "TomlSnapshot::open + to_document (integers)", ints.size() * 1e3 / ns);
+
+   std::remove("bench.snapshot");
+}
+
+struct BenchConfig {
+   std::string host;
+   int port;
+   double timeout;
+   bool verbose;
+   std::vector<std::int64_t> ports;
+};
+
+// bench_schema
+// Compares parsing into a struct with parsing a document and reading each key
+void bench_schema() {
+   std::string source;
+   for (int i = 0; i < 20; i++) source += "[service" + std::to_string(i) + "]\nunused = \"x\"\n";
+   source += "[server]\nhost = \"example.com\"\nport = 8080\ntimeout = 2.5\nverbose = true\n"
+      "ports = [8001, 8002, 8003]\n";
+
+   TomlParser toml;
+   double ns = bench::time_ns([&] {
+      auto doc = toml.parse_buffer(source);
+      BenchConfig config;
+      config.host = doc.get_as<std::string>("server.host");
+      config.port = doc.get_as<int>("server.port");
+      config.timeout = doc.get_as<double>("server.timeout");
+      config.verbose = doc.get_as<bool>("server.verbose");
+      config.ports = doc.get_array_as<std::int64_t>("server.ports");
+      bench::sink = config.port;
+   }, 1);
+   bench::report("parse_buffer + get_as (5 keys)", ns);
+
+   static const TomlSchema<BenchConfig> schema = TomlSchema<BenchConfig>()
+      .required("server.host", &BenchConfig::host)
+      .required("server.port", &BenchConfig::port)
+      .required("server.timeout", &BenchConfig::timeout)
+      .required("server.verbose", &BenchConfig::verbose)
+      .required("server.ports", &BenchConfig::ports);
+
+   ns = bench::time_ns([&] {
+      BenchConfig config;
+      schema.parse_buffer(toml, source, config);
+      bench::sink = config.port;
+   }, 1);
+   bench::report("TomlSchema::parse_buffer (5 keys)", ns);
+}
+
+// bench_corpus
+// Runs the parse, lookup and write benchmarks over one corpus, reading its files
+// from disk the way a program would
+void bench_corpus(const Corpus &corpus) {
+   std::vector<std::string> filenames;
+   for (size_t i = 0; i < corpus.files.size(); i++) {
+      filenames.push_back("bench." + corpus.name + "." + std::to_string(i) + ".toml");
+      std::ofstream(filenames.back(), std::ios::binary) << corpus.files[i];
+   }
+
+   std::vector<TomlDocument> docs;
+   long long allocations = bench::allocations();
+   for (auto &filename : filenames) docs.push_back(TomlParser(filename).parse());
+   allocations = bench::allocations() - allocations;
+
+   std::vector<std::string> keys;
+   size_t num_keys = 0;
+   for (auto &doc : docs) {
+      num_keys += doc.size();
+      for (auto it = doc.cbegin(); it != doc.cend(); ++it) keys.push_back(it->first);
+   }
+
+   char name[128];
+   double ns = bench::time_ns([&] {
+      for (auto &filename : filenames) bench::sink = TomlParser(filename).parse().size();
+   }, 1);
+   snprintf(name, sizeof(name), "TomlParser::parse (%s)", corpus.name.c_str());
+   printf("%-48s %12.2f MB/s\n", name, corpus.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      size_t k = 0;
+      for (auto &doc : docs) {
+         for (size_t end = k + doc.size(); k < end; k++) bench::sink = doc.get(keys[k]) != nullptr;
+      }
+   }, num_keys);
+   snprintf(name, sizeof(name), "TomlDocument::get (%s)", corpus.name.c_str());
+   bench::report(name, ns);
+
+   ns = bench::time_ns([&] {
+      size_t k = 0;
+      for (auto &doc : docs) {
+         for (size_t end = k + doc.size(); k < end; k++) bench::sink = doc.get_as<long long>(keys[k]);
+      }
+   }, num_keys);
+   snprintf(name, sizeof(name), "TomlDocument::get_as (%s)", corpus.name.c_str());
+   bench::report(name, ns);
+
+   ns = bench::time_ns([&] {
+      for (auto &doc : docs) {
+         std::ostringstream out;
+         doc.write(out);
+         bench::sink = out.tellp();
+      }
+   }, 1);
+   snprintf(name, sizeof(name), "TomlDocument::write (%s)", corpus.name.c_str());
+   printf("%-48s %12.2f MB/s\n", name, corpus.size() * 1e3 / ns);
+
+   ns = bench::time_ns([&] {
+      for (auto &doc : docs) {
+         for (auto it = doc.cbegin(); it != doc.cend(); ++it) bench::sink = it->second->to_string().size();
+      }
+   }, num_keys);
+   snprintf(name, sizeof(name), "TomlValue::to_string (%s)", corpus.name.c_str());
+   bench::report(name, ns);
+
+   snprintf(name, sizeof(name), "Allocations per document (%s)", corpus.name.c_str());
+   printf("%-48s %12.0f\n", name, static_cast<double>(allocations) / docs.size());
+
+   // The peak of the whole process so far, so run a corpus on its own to see its peak
+   snprintf(name, sizeof(name), "Peak RSS (%s)", corpus.name.c_str());
+   printf("%-48s %12ld KB\n", name, bench::peak_rss_kb());
+
+   for (auto &filename : filenames) std::remove(filename.c_str());
+}
+
+// Runs the named suites and corpora (for example "parse" or "small-files"), or
+// everything if none are named
+int main(int argc, char **argv) {
+   std::vector<std::string> names(argv + 1, argv + argc);
+   auto selected = [&](const std::string &name) {
+      return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+   };
+
+   if (selected("values")) bench_value_reads();
+   if (selected("shared")) bench_shared_reads();
+   if (selected("parse")) bench_parse();
+   if (selected("write")) bench_write();
+   if (selected("snapshot")) bench_snapshot();
+   if (selected("schema")) bench_schema();
+
+   for (auto &corpus : make_corpora()) {
+      if (selected("corpus") || selected(corpus.name)) bench_corpus(corpus);
+   }
+}
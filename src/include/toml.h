@@ -2,27 +2,156 @@
 #define CTOML_SRC_INCLUDE_TOML_H_
 
 #include "tomlvalue.h"
+#include "tomlfile.h"
+#include "tomlarena.h"
+#include "tomltable.h"
+#include "tomlhandler.h"
+#include "tomlstats.h"
 
-#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <string>
-#include <cstdarg>
-#include <fstream>
+#include <cstring>
 
 namespace ctoml {
+   class TomlLazyDocument;
+   class TomlBinder;
+   struct TomlDiff;
+
+   // What kind of error a TomlError is
+   enum class TomlErrorCode {
+      ExpectedChar, // A particular character was expected
+      InvalidEscape, // A string has an unknown escape sequence
+      InvalidValue, // A value is not a string, number, boolean, datetime or array
+      OutOfRange, // A number does not fit in 64 bits
+      DuplicateKey, // A key, or a key group it is in, is already used
+      TypeMismatch, // A value does not suit its TomlSchema member
+      MissingKey, // A required TomlSchema key is missing
+      LimitExceeded // The source breaks one of the parser's TomlParseLimits
+   };
+
    struct TomlError {
       std::string message;
       int line_no;
 
-      TomlError(const char *msg, int line) : message(msg), line_no(line) { }
+      TomlErrorCode code;
+      size_t offset; // Bytes from the start of the source
+      int column; // Bytes from the start of the line
+
+      // Errors with no place in the source, such as a missing key whose table
+      // never appears, have a line_no and column of -1 and an offset of npos
+      static const size_t npos = static_cast<size_t>(-1);
+
+      TomlError(TomlErrorCode code, std::string message, int line, size_t offset, int column) :
+         message(message), line_no(line), code(code), offset(offset), column(column) { }
+   };
+
+   // A key whose hash is computed at compile time, for keys that are read often:
+   //    static constexpr TomlKey kPort("server.port");
+   //    int port = doc.get_as<int>(kPort);
+   struct TomlKey {
+      const char *str;
+      size_t len;
+      std::uint64_t hash;
+
+      template <size_t N>
+      constexpr TomlKey(const char (&key)[N]) : str(key), len(N - 1), hash(toml_key_hash(key, N - 1)) { }
+   };
+
+   // A key resolved to the slot holding its value (see TomlDocument::resolve)
+   struct TomlKeyHandle {
+      size_t slot;
+
+      TomlKeyHandle() : slot(TomlTable::npos) { }
+      explicit TomlKeyHandle(size_t s) : slot(s) { }
+
+      // Returns false if the key did not exist when it was resolved
+      bool valid() const { return slot != TomlTable::npos; }
    };
 
    class TomlDocument {
+   public:
+      typedef std::pair<std::string, std::shared_ptr<TomlValue>> value_type;
+      typedef std::vector<value_type>::const_iterator const_iterator;
    private:
-       // Stores the key-value pairs. The keys are the full key name (with period notation)
-      std::unordered_map<std::string, std::shared_ptr<TomlValue>> values_;
+      // Stores the key-value pairs in insertion order. The keys are the full key
+      // name (with period notation). Tables refer to values by their index here.
+      std::vector<value_type> values_;
+
+      // The root of the key hierarchy
+      TomlTable root_;
+
+      // Open addressing index from the hash of a full key to its slot, used to look
+      // up TomlKeys without hashing. Empty buckets have a slot of TomlTable::npos.
+      struct PathIndexEntry {
+         std::uint64_t hash;
+         size_t slot;
+      };
+      std::vector<PathIndexEntry> path_index_;
+
+      void index_path(std::uint64_t hash, size_t slot);
+      size_t find_path(const char *key, size_t len, std::uint64_t hash) const;
+
+      // Arena holding the parsed values, if the document was parsed in arena mode
+      std::shared_ptr<TomlArena> arena_;
+
+      // The source sections the document was parsed from (sorted by the hash of
+      // their text) and the slots their values went into, if it came from
+      // TomlParser::reparse and has not been modified since
+      struct Section {
+         std::uint64_t hash;
+         size_t first_slot;
+         size_t num_slots;
+         size_t offset, size; // The section's text in source_
+
+         bool operator<(const Section &other) const { return hash < other.hash; }
+      };
+      std::vector<Section> sections_;
+
+      // A copy of the text the sections came from, so that a section whose hash
+      // matches can be checked byte for byte before it is reused
+      std::shared_ptr<const std::string> source_;
+
+      // Returns the section whose text is text[0, size), or nullptr
+      const Section *find_section(std::uint64_t hash, const char *text, size_t size) const;
+
+      // Returns the slot holding the value for key[0, len), or TomlTable::npos
+      size_t find_slot(const char *key, size_t len) const;
+
+      // Walks the dotted path key[0, len) down from table, creating any missing
+      // tables, and returns the last one. Returns nullptr if a prefix of the path
+      // already holds a value; *conflict is then set to the length of that prefix.
+      TomlTable *make_tables(TomlTable *table, const char *key, size_t len, size_t *conflict = nullptr);
+
+      // Adds a value to a table under name, storing full_key in its slot
+      void add_value(TomlTable *table, const char *name, size_t len, const std::string &full_key,
+         std::shared_ptr<TomlValue> value);
+
+      bool insert_or_set(const std::string &key, std::shared_ptr<TomlValue> value, bool replace);
+
+      template <class T>
+      static T value_as(const TomlValue *value) {
+         return value ? toml_value_cast<T>(*value) : T();
+      }
+
+      template <class T>
+      static std::vector<T> array_as(const TomlValue *value) {
+         if (!value || value->type() != TomlType::Array) return std::vector<T>();
+         return static_cast<const TomlArray *>(value)->as_vector<T>();
+      }
+
+      friend class TomlParser;
+      friend class TomlLazyDocument;
    public:
-      typedef std::unordered_map<std::string, std::shared_ptr<TomlValue>>::const_iterator const_iterator;
+
+      TomlDocument() { }
+
+      // Create a document whose values are allocated from an arena it owns.
+      // The values are destroyed along with the last copy of the document.
+      explicit TomlDocument(std::shared_ptr<TomlArena> arena) : arena_(arena) { }
+
+      // Returns the document's arena, or nullptr if values are heap allocated
+      std::shared_ptr<TomlArena> arena() const { return arena_; }
 
       void Print() const;
 
@@ -30,69 +159,282 @@ namespace ctoml {
       const_iterator cbegin() const;
       const_iterator cend() const;
 
-      // Inserts a new TOML value with a key
-      void insert(std::string key, std::shared_ptr<TomlValue> value);
-      void insert(std::string key, std::unique_ptr<TomlValue> value);
+      // Returns the number of keys
+      size_t size() const { return values_.size(); }
 
-      // Set a TOML key to a value
-      void set(std::string key, std::shared_ptr<TomlValue> value);
-      void set(std::string key, std::unique_ptr<TomlValue> value);
+      // Inserts a new TOML value with a key. Returns false if the key is already
+      // used or if part of its key group is a value.
+      bool insert(std::string key, std::shared_ptr<TomlValue> value);
+      bool insert(std::string key, std::unique_ptr<TomlValue> value);
+
+      // Set a TOML key to a value. Returns false if part of its key group is a value.
+      bool set(std::string key, std::shared_ptr<TomlValue> value);
+      bool set(std::string key, std::unique_ptr<TomlValue> value);
 
       // Returns true if the key already exists
-      bool is_key(std::string key) const;
+      bool is_key(const std::string &key) const;
+      bool is_key(const char *key) const;
+
+      // Returns the table of a key group ("" for the root table), or nullptr if there
+      // is no such group. Its entries list every key and sub-group directly under it.
+      const TomlTable *get_table(std::string key) const;
+
+      // Returns the key and value stored in a slot (see TomlTable::Entry::slot)
+      const value_type &slot(size_t index) const { return values_[index]; }
+
+      // Returns the TOML value for a particular key, or nullptr. Unlike get(), this
+      // neither copies the key nor the value's shared_ptr, and the pointer is valid
+      // until the key is set again or the document is destroyed.
+      const TomlValue *find(const char *key, size_t len) const;
+      const TomlValue *find(const char *key) const { return find(key, strlen(key)); }
+      const TomlValue *find(const std::string &key) const { return find(key.data(), key.size()); }
+
+      template <class T>
+      const T *find(const char *key) const {
+         return static_cast<const T *>(find(key));
+      }
+
+      template <class T>
+      const T *find(const std::string &key) const {
+         return static_cast<const T *>(find(key));
+      }
+
+      // Resolve a key once, so that it can be read repeatedly by indexing straight
+      // into the document. Handles are valid for this document and its copies, and
+      // keep referring to the key when set() replaces its value.
+      TomlKeyHandle resolve(const char *key) const { return TomlKeyHandle(find_slot(key, strlen(key))); }
+      TomlKeyHandle resolve(const std::string &key) const { return TomlKeyHandle(find_slot(key.data(), key.size())); }
+      TomlKeyHandle resolve(const TomlKey &key) const { return TomlKeyHandle(find_path(key.str, key.len, key.hash)); }
+
+      const TomlValue *find(TomlKeyHandle handle) const {
+         return handle.valid() ? values_[handle.slot].second.get() : nullptr;
+      }
+
+      const TomlValue *find(const TomlKey &key) const {
+         return find(resolve(key));
+      }
 
       // Returns the TOML value for a particular key
-      std::shared_ptr<TomlValue> get(std::string key) const;
+      std::shared_ptr<TomlValue> get(TomlKeyHandle handle) const {
+         return handle.valid() ? values_[handle.slot].second : nullptr;
+      }
+
+      std::shared_ptr<TomlValue> get(const std::string &key) const;
+      std::shared_ptr<TomlValue> get(const char *key) const;
+
+      template <class T>
+      std::shared_ptr<T> get(const std::string &key) const {
+         return std::static_pointer_cast<T>(get(key));
+      }
 
       template <class T>
-      std::shared_ptr<T> get(std::string key) const {
-         if (!is_key(key)) return nullptr;
+      std::shared_ptr<T> get(const char *key) const {
          return std::static_pointer_cast<T>(get(key));
       }
 
+      // Returns the primitive value of a key, or T() if there is no such key
+      template <class T>
+      T get_as(const std::string &key) const {
+         return value_as<T>(find(key));
+      }
+
+      template <class T>
+      T get_as(const char *key) const {
+         return value_as<T>(find(key));
+      }
+
       template <class T>
-      T get_as(std::string key) const {
-         return toml_value_cast<T>(get(key));
+      T get_as(const TomlKey &key) const {
+         return value_as<T>(find(key));
       }
 
       template <class T>
-      std::vector<T> get_array_as(std::string key) const {
-         std::vector<T> array;
+      T get_as(TomlKeyHandle handle) const {
+         return value_as<T>(find(handle));
+      }
 
-         std::shared_ptr<TomlValue> sec = get(key);
-         auto t = std::static_pointer_cast<ctoml::TomlArray>(sec);
-         for (size_t i = 0 ; i < t->size() ; i++)
-         {
-            array.push_back(toml_value_cast<T>(t->at(i)));
-         }
+      // Returns the primitive values of an array, or an empty vector if the key
+      // is not an array
+      template <class T>
+      std::vector<T> get_array_as(const std::string &key) const {
+         return array_as<T>(find(key));
+      }
 
-         return array;
+      template <class T>
+      std::vector<T> get_array_as(const char *key) const {
+         return array_as<T>(find(key));
       }
 
-      // Writes TOML document to stream
-      std::ostream &write(std::ostream &out);
+      // Writes TOML document to stream (see TomlWriter, which can also be reused
+      // to serialise many documents)
+      std::ostream &write(std::ostream &out) const;
+   };
+
+   // Bounds on what a parser accepts, for sources that can't be trusted (see
+   // TomlParser::set_limits). A limit of 0 means no limit. Parsing stops at the
+   // first limit that is broken, with a LimitExceeded error.
+   struct TomlParseLimits {
+      static const size_t kDefaultMaxDepth = 1000;
+
+      size_t max_bytes; // Size of the source
+      size_t max_depth; // How deeply arrays nest
+      size_t max_keys; // Keys in the document
+      size_t max_string_length; // Characters in a string, after unescaping
+      size_t max_array_length; // Elements in one array
+
+      // Only nesting is limited by default, so that parsing can't overflow the stack
+      TomlParseLimits() : max_bytes(0), max_depth(kDefaultMaxDepth), max_keys(0),
+         max_string_length(0), max_array_length(0) { }
+   };
+
+   // The outcome of parsing one file with TomlParser::parse_all
+   struct TomlParseResult {
+      std::string filename;
+
+      // False if the file could not be opened
+      bool good;
+
+      TomlDocument document;
+      std::vector<TomlError> errors;
+      TomlParseStats stats;
+
+      TomlParseResult() : good(false) { }
+
+      // Returns true if the file was opened and parsed without errors
+      bool success() const { return good && errors.empty(); }
    };
 
    class TomlParser {
      private:
-      std::ifstream source_file_;
-      char *cur_;
+      // The file being parsed, if the source was opened by filename
+      std::shared_ptr<TomlMappedFile> source_file_;
+
+      // The source being parsed. pos_ points to the current character
+      const char *begin_;
+      const char *pos_;
+      const char *end_;
       int cur_line_;
 
-      char cur() const { return *cur_; }
+      // When set, documents are parsed into an arena
+      bool use_arena_;
+      std::shared_ptr<TomlArena> arena_;
 
-      // List of parse errors
-      std::vector<TomlError> errors_;
-      void error(const char *format, ...);
+      // Where values (or the arena's blocks) are allocated
+      TomlMemoryResource *resource_;
 
-      bool is_whitespace(char c, bool new_line = false);
-      bool is_numeric(char c);
+      // Number of threads to parse a single document on (0 for every core)
+      unsigned num_threads_;
+
+      // Create a value, in the arena if the document being parsed has one
+      template <class T, class... Args>
+      std::shared_ptr<TomlValue> make_value(Args&&... args) {
+         if (arena_) return arena_->make_value<T>(std::forward<Args>(args)...);
+         return std::allocate_shared<T>(TomlAllocator<T>(resource_), std::forward<Args>(args)...);
+      }
+
+      // The resource for the contents of strings and arrays
+      TomlMemoryResource *value_resource() const { return arena_ ? arena_.get() : resource_; }
+
+      // Create an arena for a document, if documents are parsed into arenas
+      std::shared_ptr<TomlArena> make_arena() const;
+
+      char cur() const { return pos_ < end_ ? *pos_ : '\0'; }
 
-      bool is_integer(std::string str);
-      bool is_float(std::string str);
-      bool is_datetime(std::string str);
+      // A run of characters in the source buffer. Tokens are views, so they
+      // are only valid while the source is.
+      struct Token {
+         const char *begin;
+         const char *end;
 
-      tm to_time(std::string str);
+         size_t size() const { return end - begin; }
+         bool equals(const char *str) const;
+      };
+
+      // Reusable storage for strings with escapes and numbers being converted
+      std::string scratch_;
+
+      // Counts and times for the current source (see tomlstats.h)
+      TomlParseStats stats_;
+
+      // Start parsing a new source buffer
+      void reset(const char *data, size_t size);
+
+      // Copy the settings (but not the state) of another parser
+      void copy_settings(const TomlParser &other);
+
+      // Parse errors. Their messages are only formatted by get_error, so the
+      // text they mention is copied into error_text_ instead.
+      struct ErrorRecord {
+         TomlErrorCode code;
+         int line;
+         int column;
+         size_t offset;
+         char c; // For ExpectedChar and InvalidEscape
+         size_t text, text_size; // What the error is about, in error_text_
+         size_t detail, detail_size; // What was expected, for TypeMismatch
+      };
+      std::vector<ErrorRecord> errors_;
+      std::string error_text_;
+
+      // Parsing stops after this many errors (0 for no limit)
+      size_t max_errors_;
+
+      // Limits on the source, and what has been counted against them
+      TomlParseLimits limits_;
+      size_t depth_;
+      size_t num_keys_;
+
+      // Set once parsing has been abandoned; later errors are not recorded
+      bool stopped_;
+
+      // Set if parsing was abandoned at max_errors with entries still to parse
+      bool hit_max_errors_;
+
+      // Move to the end of the source, so that parsing winds up
+      void stop();
+
+      // Record that the source breaks a limit, and stop
+      void limit_error(int line, const char *at, const char *name, size_t limit);
+
+      // Returns false, recording an error, if the source is larger than max_bytes
+      bool check_size();
+
+      // Where an error is in the source
+      struct Position {
+         int line;
+         int column;
+         size_t offset;
+      };
+
+      // Returns the position of at (the current position if at is not in the source)
+      Position position_of(const char *at) const;
+
+      // Record an error about at (nullptr for the current position), or at a
+      // position found earlier
+      void add_error(TomlErrorCode code, int line, const char *at, char c,
+         const char *text, size_t text_size, const char *detail, size_t detail_size);
+      void add_error(TomlErrorCode code, const Position &position, char c,
+         const char *text, size_t text_size, const char *detail, size_t detail_size);
+
+      // Record an error at the current position, and skip to the next line
+      void error(TomlErrorCode code, char c);
+      void error(TomlErrorCode code, const char *at, const char *text, size_t text_size);
+
+      // Record an error on a line, without moving
+      void error_at(TomlErrorCode code, int line, const char *at, const std::string &text,
+         const std::string &detail = std::string());
+
+      // Record an error at a position found earlier, for errors reported once the
+      // source may be gone
+      void error_at(TomlErrorCode code, const Position &position, const std::string &text);
+
+      void skip_line();
+
+      // Returns the line holding at, a position in the source
+      int line_of(const char *at) const;
+
+      bool is_whitespace(char c, bool new_line = false);
+      bool is_numeric(char c);
 
       void expect(char c);
       void advance(char c, bool new_line = false);
@@ -100,16 +442,78 @@ namespace ctoml {
       void skip_whitespace_and_comments();
 
       char next_char();
-      char next_skip_whitespace(bool new_line = false);
 
-      std::shared_ptr<TomlValue> parse_string();
-      std::shared_ptr<TomlValue> parse_number();
-      std::shared_ptr<TomlValue> parse_boolean();
-      std::shared_ptr<TomlValue> parse_array();
-      std::shared_ptr<TomlValue> parse_value();
+      // Move forward to p, which the lexer has skipped over in bulk
+      void jump_to(const char *p);
+      char next_skip_whitespace(bool new_line = false);
 
-      std::string parse_key_group();
-      std::string parse_key();
+      void parse_string(TomlHandler &handler);
+      void parse_number(TomlHandler &handler);
+      void parse_boolean(TomlHandler &handler);
+      void parse_array(TomlHandler &handler);
+      void parse_value(TomlHandler &handler);
+
+      Token parse_key_group();
+      Token parse_key();
+
+      // A key group header or key/value pair that has been parsed but not yet
+      // inserted into a document
+      struct PendingEntry {
+         Token key; // The group name for headers
+         std::shared_ptr<TomlValue> value; // nullptr for headers
+      };
+
+      // The key group that keys are being inserted into
+      struct GroupState {
+         std::string name; // Group name followed by a '.'
+         TomlTable *table; // nullptr if a prefix of the group is already a value...
+         size_t conflict; // ...in which case this is the prefix's length
+         std::string key; // Scratch space for full key names
+
+         explicit GroupState(TomlDocument &doc);
+      };
+
+      void enter_group(TomlDocument &doc, GroupState &group, Token name);
+      void insert_value(TomlDocument &doc, GroupState &group, Token local_key,
+         std::shared_ptr<TomlValue> value);
+
+      // The handler parse() builds documents with (see toml.cc)
+      class Builder;
+
+      // Parse keys and values until the end of the source, reporting them to handler
+      void parse_entries(TomlHandler &handler);
+
+      // Move past a value without decoding it, returning its extent
+      Token skip_value();
+      void skip_string();
+
+      // Check the structure of the source and record where each value lies,
+      // without decoding any
+      void index_entries(TomlLazyDocument &doc);
+
+      // Like parse_entries, but for a section whose source has not changed since
+      // previous was parsed. Only the key group header is read; the section's
+      // keys and values are copied from previous.
+      void replay_section(Builder &builder, const TomlDocument &previous,
+         const TomlDocument::Section &section);
+
+      // Returns true if replaying a section keeps within the limits. If not, it
+      // is parsed again instead, so the error is reported where it is.
+      bool replay_fits(const TomlDocument &previous, const TomlDocument::Section &section) const;
+      bool value_fits(const TomlValue &value, size_t depth) const;
+
+      // Decode the value held in [begin, end) into resource. Returns nullptr if
+      // it is invalid.
+      static std::shared_ptr<TomlValue> decode_value(const char *begin, const char *end, int line,
+         TomlMemoryResource *resource);
+
+      friend class TomlLazyDocument;
+      friend class TomlBinder;
+      friend class TomlCompactDocument;
+
+      // Parse sections of the source (see find_sections) on several threads
+      void parse_sections(TomlDocument &doc, const std::vector<const char *> &sections,
+         const std::vector<int> &lines, unsigned num_threads);
      public:
       TomlParser();
       explicit TomlParser(const std::string filename);
@@ -117,13 +521,85 @@ namespace ctoml {
       // Parse the document.
       TomlDocument parse();
 
+      // Parse a document held in memory. The buffer is only read during the call.
+      TomlDocument parse_buffer(const char *data, size_t size);
+      TomlDocument parse_buffer(const std::string &source);
+
+      // Parse the document lazily (see TomlLazyDocument). Only the structure of
+      // the document is checked, and values are decoded when they are first read.
+      TomlLazyDocument parse_lazy();
+
+      // Parse a buffer lazily. The buffer must outlive the returned document.
+      TomlLazyDocument parse_buffer_lazy(const char *data, size_t size);
+
+      // Parse a new version of the source that previous was parsed from, and
+      // report the keys that were added, removed or changed in diff. Values that
+      // have not changed are shared with previous rather than copied.
+      //
+      // If previous also came from reparse, the source is split at top-level key
+      // group headers (as with set_threads) and sections whose text is unchanged
+      // are not decoded again. To tell, the document keeps a copy of its source.
+      // Always parses on one thread, without an arena.
+      TomlDocument reparse(const TomlDocument &previous, TomlDiff &diff);
+      TomlDocument reparse_buffer(const TomlDocument &previous, const char *data, size_t size,
+         TomlDiff &diff);
+
+      // Parse the document as a stream of events, without building a TomlDocument.
+      // Memory use does not grow with the document. Always runs on one thread.
+      void parse(TomlHandler &handler);
+      void parse_buffer(const char *data, size_t size, TomlHandler &handler);
+      void parse_buffer(const std::string &source, TomlHandler &handler);
+
+      // Returns the line being parsed (counting from 0). Handlers can call this
+      // to find where an event came from.
+      int line() const { return cur_line_; }
+
+      // Parse many files concurrently on up to num_threads threads (0 uses every
+      // core). Each file gets its own parser with this parser's settings, and is
+      // parsed on a single thread. Results are returned in the same order as filenames.
+      std::vector<TomlParseResult> parse_all(const std::vector<std::string> &filenames,
+         unsigned num_threads = 0) const;
+
+      // Parse documents into a single arena owned by the document rather than
+      // allocating every value separately. Each value held outside the document
+      // keeps the whole arena alive. Off by default.
+      void set_use_arena(bool use_arena) { use_arena_ = use_arena; }
+
+      // Allocate documents' values, including the contents of strings and arrays,
+      // from resource (or take the arena's blocks from it). The resource must
+      // outlive the documents, and be thread safe if the parser runs on several
+      // threads (see TomlMemoryResource). Values of lazy documents come from it as
+      // they are decoded. Keys and the key index still use the global heap.
+      // Defaults to toml_default_resource().
+      void set_memory_resource(TomlMemoryResource *resource) { resource_ = resource; }
+
+      // Stop parsing once max_errors errors have been found, so that checking a
+      // large, badly broken file costs little. 1 stops at the first error. Defaults
+      // to 0, which finds every error.
+      void set_max_errors(size_t max_errors) { max_errors_ = max_errors; }
+
+      // Returns true if the last parse stopped early because of set_max_errors
+      bool hit_max_errors() const { return hit_max_errors_; }
+
+      // Bound the size, nesting, number of keys and length of strings and arrays
+      // of sources, which are checked as they are parsed. Lazily parsed documents
+      // check all but array lengths up front.
+      void set_limits(const TomlParseLimits &limits) { limits_ = limits; }
+      const TomlParseLimits &limits() const { return limits_; }
+
+      // Parse large documents on up to num_threads threads (0 uses every core).
+      // The document is split at top-level key group headers, the sections are
+      // parsed in parallel and then merged. Results, including errors, are the same
+      // as parsing on one thread. Defaults to 1.
+      void set_threads(unsigned num_threads) { num_threads_ = num_threads; }
+
       // Returns true if the input file is valid
       bool good() const;
 
       // Returns true if no were no errors after parsing
       bool success() const;
 
-      // Open a file. Returns true if good()
+      // Open (memory-map) a file. Returns true if good()
       bool open(const std::string filename);
 
       // Close file
@@ -132,8 +608,13 @@ namespace ctoml {
       // Returns the number of errors
       size_t num_errors() const { return errors_.size(); }
 
-      // Returns the ith error
-      TomlError get_error(int i) const { return errors_[i]; }
+      // Returns what the parser did with the current (or last) source: how much
+      // it scanned and allocated and where the time went. Only collected when
+      // the library is built with CTOML_ENABLE_STATS; otherwise always zero.
+      const TomlParseStats &stats() const { return stats_; }
+
+      // Returns the ith error, formatting its message
+      TomlError get_error(int i) const;
    };
 }
 
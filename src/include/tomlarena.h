@@ -0,0 +1,113 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLARENA_H_
+#define CTOML_SRC_INCLUDE_TOMLARENA_H_
+
+#include "tomlmemory.h"
+#include "tomlvalue.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ctoml {
+   // A monotonic allocator for TOML values. Memory is carved out of large blocks
+   // and is only released, all at once, when the arena is destroyed. Objects that
+   // are trivially destructible are simply dropped; the rest have their
+   // destructors run in reverse order of creation.
+   //
+   // Values made by make_value() are handed out as shared_ptrs that share
+   // ownership of the arena, so the existing shared_ptr based API keeps working
+   // without a control block per value, and a value keeps its arena alive for as
+   // long as it is held. Arenas that make values must be owned by a shared_ptr.
+   //
+   // The blocks come from an upstream memory resource. The arena is a memory
+   // resource itself, so the strings and arrays inside its values can live in it
+   // too; deallocating from it does nothing.
+   class TomlArena : public TomlMemoryResource, public std::enable_shared_from_this<TomlArena> {
+   private:
+      // Destructor to run when the arena goes away
+      struct Cleanup {
+         void (*destroy)(void *);
+         void *object;
+         Cleanup *next;
+      };
+
+      struct Block {
+         char *data;
+         size_t size;
+      };
+
+      TomlMemoryResource *upstream_;
+      std::vector<Block> blocks_;
+      std::vector<std::shared_ptr<TomlArena>> attached_;
+      char *cur_;
+      char *end_;
+      size_t block_size_;
+      size_t bytes_allocated_;
+      Cleanup *cleanups_;
+
+      TomlArena(const TomlArena &) = delete;
+      TomlArena &operator=(const TomlArena &) = delete;
+
+      template <class T>
+      static void destroy(void *object) {
+         static_cast<T *>(object)->~T();
+      }
+
+      // Arrays hold elements from their own arena without a reference to it
+      static void adopt(TomlValue *, const std::shared_ptr<TomlArena> &) { }
+      static void adopt(TomlArray *array, const std::shared_ptr<TomlArena> &arena) { array->arena_ = arena; }
+
+   protected:
+      void *do_allocate(size_t size, size_t align) { return allocate(size, align); }
+      void do_deallocate(void *, size_t, size_t) { }
+   public:
+      // Create an arena that allocates in blocks of block_size bytes, taken from upstream
+      explicit TomlArena(size_t block_size = 64 * 1024, TomlMemoryResource *upstream = toml_default_resource());
+      explicit TomlArena(TomlMemoryResource *upstream, size_t block_size = 64 * 1024);
+      ~TomlArena();
+
+      // Allocate raw memory from the arena
+      void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+      // Construct an object in the arena
+      template <class T, class... Args>
+      T *create_object(Args&&... args) {
+         void *mem = allocate(sizeof(T), alignof(T));
+         T *object = new (mem) T(std::forward<Args>(args)...);
+
+         if (!std::is_trivially_destructible<T>::value) {
+            Cleanup *cleanup = static_cast<Cleanup *>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+            cleanup->destroy = &TomlArena::destroy<T>;
+            cleanup->object = object;
+            cleanup->next = cleanups_;
+            cleanups_ = cleanup;
+         }
+
+         return object;
+      }
+
+      // Construct a TOML value in the arena. The returned pointer keeps the arena alive.
+      template <class T, class... Args>
+      std::shared_ptr<TomlValue> make_value(Args&&... args) {
+         std::shared_ptr<TomlArena> owner = shared_from_this();
+         T *value = create_object<T>(std::forward<Args>(args)...);
+         adopt(value, owner);
+
+         return std::shared_ptr<TomlValue>(owner, value);
+      }
+
+      // Returns the resource the blocks come from
+      TomlMemoryResource *upstream() const { return upstream_; }
+
+      // Keep another arena alive for as long as this one
+      void attach(std::shared_ptr<TomlArena> other) { attached_.push_back(other); }
+
+      // Returns the number of bytes handed out so far
+      size_t bytes_allocated() const { return bytes_allocated_; }
+   };
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLCOMPACT_H_
+#define CTOML_SRC_INCLUDE_TOMLCOMPACT_H_
+
+#include "tomlvalue.h"
+#include "tomlarena.h"
+#include "tomlhandler.h"
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace ctoml {
+   class TomlDocument;
+   class TomlParser;
+
+   // A TOML value packed into 16 bytes: the type tag, a length for strings and
+   // arrays, and the payload itself. Strings and array elements are stored out of
+   // line in the owning document's arena. There is no virtual dispatch, so a typed
+   // read is a tag check and a load.
+   class TomlCompactValue {
+   private:
+      TomlType type_;
+      std::uint32_t size_; // Length of a string or array
+
+      union {
+         std::int64_t int_;
+         double float_;
+         bool boolean_;
+         std::int64_t datetime_;
+         const char *string_;
+         const TomlCompactValue *array_;
+      };
+
+      friend class TomlCompactDocument;
+   public:
+      TomlCompactValue() : type_(TomlType::Int), size_(0), int_(0) { }
+
+      // Returns the type of this TOML value
+      TomlType type() const { return type_; }
+
+      // Typed reads. A value of another type reads as zero (or empty).
+      std::int64_t int_value() const { return type_ == TomlType::Int ? int_ : 0; }
+      double float_value() const { return type_ == TomlType::Float ? float_ : 0.0; }
+      bool bool_value() const { return type_ == TomlType::Boolean && boolean_; }
+      time_t datetime_value() const { return type_ == TomlType::DateTime ? static_cast<time_t>(datetime_) : 0; }
+
+      // String contents (not null terminated) and length
+      const char *string_data() const { return type_ == TomlType::String ? string_ : ""; }
+      std::string string_value() const { return std::string(string_data(), size()); }
+
+      // Number of characters in a string or elements in an array
+      size_t size() const { return (type_ == TomlType::String || type_ == TomlType::Array) ? size_ : 0; }
+
+      // Array element access
+      const TomlCompactValue &operator[](size_t index) const { return array_[index]; }
+      const TomlCompactValue *begin() const { return type_ == TomlType::Array ? array_ : nullptr; }
+      const TomlCompactValue *end() const { return begin() + size(); }
+
+      // Convert the value to a primitive type, like toml_value_cast
+      template <class T>
+      T as() const {
+         switch (type_) {
+            case TomlType::Boolean: return static_cast<T>(boolean_);
+            case TomlType::Int: return static_cast<T>(int_);
+            case TomlType::Float: return static_cast<T>(float_);
+            case TomlType::DateTime: return static_cast<T>(datetime_);
+            default: return T();
+         }
+      }
+   };
+
+   template <>
+   inline std::string TomlCompactValue::as<std::string>() const {
+      return string_value();
+   }
+
+   static_assert(sizeof(TomlCompactValue) == 16, "TomlCompactValue should pack into 16 bytes");
+
+   // A read-only document that stores its values as TomlCompactValues. It is
+   // filled straight from the parser's events, so no TomlValues are made:
+   //
+   //    TomlCompactDocument doc;
+   //    if (!doc.parse(parser)) ...
+   //
+   // or copied from a TomlDocument that has already been parsed.
+   class TomlCompactDocument {
+   public:
+      // Longest string or array a TomlCompactValue can hold
+      static const size_t kMaxSize = 0xffffffff;
+   private:
+      std::unordered_map<std::string, TomlCompactValue> values_;
+
+      // Holds strings and array elements
+      std::shared_ptr<TomlArena> arena_;
+
+      class Builder;
+
+      TomlCompactValue convert(const TomlValue &value);
+
+      // Copy a string or array elements into the arena. Throws std::length_error
+      // if there are more than kMaxSize.
+      TomlCompactValue make_string(const char *str, size_t len);
+      TomlCompactValue make_array(const TomlCompactValue *elements, size_t size);
+   public:
+      typedef std::unordered_map<std::string, TomlCompactValue>::const_iterator const_iterator;
+
+      TomlCompactDocument();
+
+      // Build a compact copy of a parsed document. Throws std::length_error if a
+      // string or array is longer than kMaxSize.
+      explicit TomlCompactDocument(const TomlDocument &doc);
+
+      // Parse the parser's file, or a buffer, into this document, replacing its
+      // contents. Keys that are defined twice or used as both a value and a key
+      // group, and strings or arrays longer than kMaxSize, are reported as a
+      // TomlError by the parser. Returns parser.success().
+      bool parse(TomlParser &parser);
+      bool parse_buffer(TomlParser &parser, const char *data, size_t size);
+      bool parse_buffer(TomlParser &parser, const std::string &source);
+
+      // Iterate through each key
+      const_iterator cbegin() const { return values_.cbegin(); }
+      const_iterator cend() const { return values_.cend(); }
+
+      // Returns the number of keys
+      size_t size() const { return values_.size(); }
+
+      // Returns the value for a key, or nullptr if there is no such key
+      const TomlCompactValue *get(const std::string &key) const;
+
+      template <class T>
+      T get_as(const std::string &key) const {
+         const TomlCompactValue *value = get(key);
+         return value ? value->as<T>() : T();
+      }
+   };
+}
+
+#endif
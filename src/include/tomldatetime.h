@@ -0,0 +1,28 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLDATETIME_H_
+#define CTOML_SRC_INCLUDE_TOMLDATETIME_H_
+
+#include <cstddef>
+#include <ctime>
+
+// UTC datetimes in the fixed RFC 3339 form TOML uses, YYYY-MM-DDThh:mm:ssZ.
+// Conversions are done arithmetically, so unlike mktime/gmtime they never touch
+// the time zone or any shared state and are safe to call from many threads.
+
+namespace ctoml {
+   // Length of a formatted datetime, not counting the terminating null
+   const size_t kTomlDateTimeLength = 20;
+
+   // Parses [begin, end) as a datetime. Returns false if it is not one, or if a
+   // field is out of range.
+   bool toml_parse_datetime(const char *begin, const char *end, time_t *value);
+
+   // Writes value into buf, which must hold kTomlDateTimeLength + 1 characters.
+   // Returns the length written.
+   size_t toml_format_datetime(time_t value, char *buf);
+
+   // Converts broken down time, taken to be in UTC, to seconds since the epoch.
+   // Fields outside their usual ranges are normalised, as with timegm.
+   time_t toml_time_from_tm(const tm &time);
+}
+
+#endif
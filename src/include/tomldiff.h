@@ -0,0 +1,30 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLDIFF_H_
+#define CTOML_SRC_INCLUDE_TOMLDIFF_H_
+
+#include "toml.h"
+
+#include <string>
+#include <vector>
+
+namespace ctoml {
+   // The keys that differ between two versions of a document. Added and changed
+   // keys are listed in the order of the new document, removed keys in the order
+   // of the old one. Look the values up in the documents themselves.
+   struct TomlDiff {
+      std::vector<std::string> added;
+      std::vector<std::string> removed;
+      std::vector<std::string> changed;
+
+      // Returns true if the documents have the same keys and values
+      bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+   };
+
+   // Returns true if two values have the same type and contents. Arrays are
+   // compared element by element.
+   bool toml_values_equal(const TomlValue &a, const TomlValue &b);
+
+   // Compares two documents key by key
+   TomlDiff toml_diff(const TomlDocument &before, const TomlDocument &after);
+}
+
+#endif
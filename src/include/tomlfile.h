@@ -0,0 +1,41 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLFILE_H_
+#define CTOML_SRC_INCLUDE_TOMLFILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace ctoml {
+   // A read-only, contiguous view of a file's contents. On POSIX systems the
+   // file is memory-mapped; elsewhere it is read into memory in one go.
+   class TomlMappedFile {
+   private:
+      const char *data_;
+      size_t size_;
+      bool mapped_;
+      bool good_;
+
+      // Fallback storage when the file is not memory-mapped
+      std::string buffer_;
+
+      TomlMappedFile(const TomlMappedFile &) = delete;
+      TomlMappedFile &operator=(const TomlMappedFile &) = delete;
+   public:
+      TomlMappedFile();
+      ~TomlMappedFile();
+
+      // Map a file. Returns true if good()
+      bool open(const std::string &filename);
+
+      // Unmap the file
+      void close();
+
+      // Returns true if a file is currently mapped
+      bool good() const { return good_; }
+
+      // Access the file contents
+      const char *data() const { return data_; }
+      size_t size() const { return size_; }
+   };
+}
+
+#endif
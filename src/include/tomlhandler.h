@@ -0,0 +1,41 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLHANDLER_H_
+#define CTOML_SRC_INCLUDE_TOMLHANDLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+namespace ctoml {
+   // Receives a document as a stream of events from TomlParser::parse(TomlHandler &),
+   // in source order, without a TomlDocument being built. Override the events
+   // you need; the rest are ignored.
+   //
+   // A key/value pair is reported as on_key followed by the events for its value.
+   // An array value is reported as on_array_begin, the events for each element,
+   // then on_array_end. Names and strings point into the source or a scratch
+   // buffer, so they are only valid for the duration of the call.
+   //
+   // Values that fail to parse produce no event (though an array containing one
+   // still ends), and the error is recorded by the parser as usual.
+   class TomlHandler {
+   public:
+      virtual ~TomlHandler() { }
+
+      // A key group header, [name]
+      virtual void on_table_header(const char *name, size_t len) { (void)name; (void)len; }
+
+      // The key of a key/value pair, relative to the current key group
+      virtual void on_key(const char *key, size_t len) { (void)key; (void)len; }
+
+      virtual void on_string(const char *str, size_t len) { (void)str; (void)len; }
+      virtual void on_int(std::int64_t value) { (void)value; }
+      virtual void on_float(double value) { (void)value; }
+      virtual void on_boolean(bool value) { (void)value; }
+      virtual void on_datetime(time_t value) { (void)value; }
+
+      virtual void on_array_begin() { }
+      virtual void on_array_end() { }
+   };
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLLAZY_H_
+#define CTOML_SRC_INCLUDE_TOMLLAZY_H_
+
+#include "toml.h"
+
+#include <mutex>
+
+namespace ctoml {
+   // A document whose values are decoded on demand. Parsing only checks the
+   // document's structure and records where each key's value lies in the source;
+   // a value is decoded the first time it is read and cached from then on. Good
+   // for large documents of which only a few keys are read.
+   //
+   // The source must outlive the document. Files opened by the parser are kept
+   // mapped by the document; buffers passed to parse_buffer_lazy are borrowed.
+   //
+   // Errors within values are only found when they are decoded, so reading an
+   // invalid value returns nullptr. Reads may be made from several threads.
+   class TomlLazyDocument {
+   private:
+      // Keys, with each value nullptr until it is decoded
+      mutable TomlDocument index_;
+
+      // Where each slot's value lies in the source
+      struct Span {
+         const char *begin;
+         const char *end;
+         int line;
+      };
+      std::vector<Span> spans_;
+
+      std::shared_ptr<TomlMappedFile> file_;
+
+      // Where decoded values are allocated. Lazy documents never use an arena.
+      TomlMemoryResource *resource_;
+
+      // Guards decoding
+      std::unique_ptr<std::mutex> mutex_;
+      mutable size_t num_decoded_;
+
+      // Returns the value in a slot, decoding it if needed
+      const std::shared_ptr<TomlValue> &decode(size_t slot) const;
+
+      friend class TomlParser;
+   public:
+      TomlLazyDocument() : resource_(toml_default_resource()), mutex_(new std::mutex()), num_decoded_(0) { }
+
+      // Returns the number of keys
+      size_t size() const { return index_.size(); }
+
+      // Returns the number of values decoded so far
+      size_t num_decoded() const;
+
+      // Returns true if the key exists
+      bool is_key(const std::string &key) const { return index_.is_key(key); }
+      bool is_key(const char *key) const { return index_.is_key(key); }
+
+      // Returns the value for a key, or nullptr. The pointer is valid for the
+      // lifetime of the document.
+      const TomlValue *find(const char *key, size_t len) const;
+      const TomlValue *find(const char *key) const { return find(key, strlen(key)); }
+      const TomlValue *find(const std::string &key) const { return find(key.data(), key.size()); }
+
+      std::shared_ptr<TomlValue> get(const char *key, size_t len) const;
+      std::shared_ptr<TomlValue> get(const char *key) const { return get(key, strlen(key)); }
+      std::shared_ptr<TomlValue> get(const std::string &key) const { return get(key.data(), key.size()); }
+
+      // Returns the primitive value of a key, or T() if there is no such key
+      template <class T>
+      T get_as(const std::string &key) const {
+         const TomlValue *value = find(key);
+         return value ? toml_value_cast<T>(*value) : T();
+      }
+
+      template <class T>
+      T get_as(const char *key) const {
+         const TomlValue *value = find(key);
+         return value ? toml_value_cast<T>(*value) : T();
+      }
+   };
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLMEMORY_H_
+#define CTOML_SRC_INCLUDE_TOMLMEMORY_H_
+
+#include <cstddef>
+#include <new>
+
+namespace ctoml {
+   // A source of memory for documents, in the manner of C++17's
+   // std::pmr::memory_resource. Derive from it to draw values from a pool, an
+   // arena or a per-tenant budget, and hand it to TomlParser::set_memory_resource.
+   // Alignments are at most alignof(std::max_align_t).
+   //
+   // A resource must be thread safe if it is used by a parser that runs on
+   // several threads (set_threads, parse_all), or by documents that are read or
+   // released on different threads: parser threads allocate from it at the
+   // same time, and values go back to it on whichever thread drops them last.
+   class TomlMemoryResource {
+   protected:
+      virtual void *do_allocate(size_t size, size_t align) = 0;
+      virtual void do_deallocate(void *p, size_t size, size_t align) = 0;
+   public:
+      virtual ~TomlMemoryResource() { }
+
+      void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+         return do_allocate(size, align);
+      }
+
+      // p must have come from allocate() with the same size and alignment
+      void deallocate(void *p, size_t size, size_t align = alignof(std::max_align_t)) {
+         do_deallocate(p, size, align);
+      }
+   };
+
+   // The resource used when none is given, which uses global operator new and delete
+   TomlMemoryResource *toml_default_resource();
+
+   // A standard allocator that draws from a TomlMemoryResource, so containers
+   // inside values can use the same memory as the values themselves. As with
+   // std::pmr::polymorphic_allocator, copying a container does not carry the
+   // resource over: the copy uses the default resource.
+   template <class T>
+   class TomlAllocator {
+   private:
+      TomlMemoryResource *resource_;
+   public:
+      typedef T value_type;
+
+      TomlAllocator() : resource_(toml_default_resource()) { }
+      TomlAllocator(TomlMemoryResource *resource) : resource_(resource) { }
+
+      template <class U>
+      TomlAllocator(const TomlAllocator<U> &other) : resource_(other.resource()) { }
+
+      T *allocate(size_t n) {
+         if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+         return static_cast<T *>(resource_->allocate(n * sizeof(T), alignof(T)));
+      }
+
+      void deallocate(T *p, size_t n) {
+         resource_->deallocate(p, n * sizeof(T), alignof(T));
+      }
+
+      TomlAllocator select_on_container_copy_construction() const { return TomlAllocator(); }
+
+      TomlMemoryResource *resource() const { return resource_; }
+   };
+
+   template <class T, class U>
+   bool operator==(const TomlAllocator<T> &a, const TomlAllocator<U> &b) {
+      return a.resource() == b.resource();
+   }
+
+   template <class T, class U>
+   bool operator!=(const TomlAllocator<T> &a, const TomlAllocator<U> &b) {
+      return a.resource() != b.resource();
+   }
+}
+
+#endif
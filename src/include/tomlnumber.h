@@ -0,0 +1,22 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLNUMBER_H_
+#define CTOML_SRC_INCLUDE_TOMLNUMBER_H_
+
+#include <cstdint>
+
+// Number parsing for the lexer. Unlike atoll/atof these do not depend on the
+// C locale, read the text in a single pass and report values that do not fit.
+
+namespace ctoml {
+   enum class TomlNumberResult {
+      Ok, Invalid, OutOfRange
+   };
+
+   // Parses [begin, end) as an integer: digits, optionally preceded by a '-'
+   TomlNumberResult toml_parse_int(const char *begin, const char *end, std::int64_t *value);
+
+   // Parses [begin, end) as a decimal: digits with at most one decimal point,
+   // optionally preceded by a '-'
+   TomlNumberResult toml_parse_float(const char *begin, const char *end, double *value);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLSCAN_H_
+#define CTOML_SRC_INCLUDE_TOMLSCAN_H_
+
+// Bulk character scanning used by the lexer. On x86 these classify 16 (SSE2) or
+// 32 (AVX2, picked at run time) bytes at a time; elsewhere they fall back to
+// plain loops. Every function scans [p, end) and returns end if nothing matches.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ctoml {
+   // Whitespace as the lexer sees it: space, and '\t' through '\r'
+   inline bool toml_is_space(char c) {
+      return c == ' ' || (c >= '\t' && c <= '\r');
+   }
+
+   inline bool toml_is_digit(char c) {
+      return c >= '0' && c <= '9';
+   }
+
+   // Returns the first character that is not whitespace (newlines included)
+   const char *toml_skip_spaces(const char *p, const char *end);
+
+   // Returns the first '"' or '\\'
+   const char *toml_find_quote_or_escape(const char *p, const char *end);
+
+   // Returns the first character a string must escape: '"', '\\', or a control character
+   // (U+0000 to U+001F, or U+007F)
+   const char *toml_find_escapable(const char *p, const char *end);
+
+   // Returns the first character that can change the structure of a document:
+   // '"', '\\', '\n', '#', '=', '[' or ']'
+   const char *toml_find_structural(const char *p, const char *end);
+
+   // Returns the first '\n'
+   const char *toml_find_newline(const char *p, const char *end);
+
+   // Returns the number of '\n' characters in [p, end)
+   int toml_count_newlines(const char *p, const char *end);
+
+   // A fast, non-cryptographic hash of len bytes, for telling whether text has
+   // changed: XXH64 with a seed of 0. Reads four independent words at a time, so
+   // hashing costs far less than parsing the same text. Accidental collisions are
+   // vanishingly rare, but text can be crafted to collide.
+   std::uint64_t toml_hash_bytes(const char *p, size_t len);
+}
+
+#endif
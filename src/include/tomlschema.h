@@ -0,0 +1,303 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLSCHEMA_H_
+#define CTOML_SRC_INCLUDE_TOMLSCHEMA_H_
+
+#include "toml.h"
+#include "tomlhandler.h"
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace ctoml {
+   // Stores values of one C++ type. Each store returns false if the value has the
+   // wrong type (or does not fit), leaving the target untouched.
+   class TomlFieldSink {
+   public:
+      virtual ~TomlFieldSink() { }
+
+      virtual bool store_string(void *target, const char *str, size_t len) const {
+         (void)target; (void)str; (void)len; return false;
+      }
+      virtual bool store_int(void *target, std::int64_t value) const { (void)target; (void)value; return false; }
+      virtual bool store_float(void *target, double value) const { (void)target; (void)value; return false; }
+      virtual bool store_boolean(void *target, bool value) const { (void)target; (void)value; return false; }
+      virtual bool store_datetime(void *target, time_t value) const { (void)target; (void)value; return false; }
+
+      // For arrays: the sink for the elements (nullptr if this is not an array),
+      // and functions to empty the array and to append an element to it
+      virtual const TomlFieldSink *element() const { return nullptr; }
+      virtual void clear(void *target) const { (void)target; }
+      virtual void *append(void *target) const { (void)target; return nullptr; }
+
+      // Stores an element into a temporary with store(element(), temporary, context),
+      // appending it only if that succeeds
+      typedef bool (*StoreElement)(const TomlFieldSink *sink, void *target, const void *context);
+      virtual bool append_stored(void *target, StoreElement store, const void *context) const {
+         (void)target; (void)store; (void)context; return false;
+      }
+
+      // What the value should be, for error messages ("an integer")
+      virtual std::string expected() const = 0;
+   };
+
+   // The sink for a type. Integers, floating point numbers, bool, std::string and
+   // std::vectors of those are supported; time_t fields use TomlDateTimeSink.
+   template <class M, class Enable = void>
+   class TomlSink;
+
+   template <class M>
+   class TomlSink<M, typename std::enable_if<std::is_integral<M>::value && !std::is_same<M, bool>::value>::type>
+      : public TomlFieldSink {
+   public:
+      bool store_int(void *target, std::int64_t value) const {
+         // Reject values that the field cannot hold, rather than truncating them
+         if (std::is_signed<M>::value ? value < static_cast<std::int64_t>(std::numeric_limits<M>::min()) : value < 0) {
+            return false;
+         }
+         if (value > 0 && static_cast<std::uint64_t>(value) > static_cast<std::uint64_t>(std::numeric_limits<M>::max())) {
+            return false;
+         }
+
+         *static_cast<M *>(target) = static_cast<M>(value);
+         return true;
+      }
+
+      std::string expected() const {
+         if (sizeof(M) >= sizeof(std::int64_t)) return std::is_signed<M>::value ? "an integer" : "a non-negative integer";
+         return "an integer from " + std::to_string(static_cast<long long>(std::numeric_limits<M>::min())) +
+            " to " + std::to_string(static_cast<long long>(std::numeric_limits<M>::max()));
+      }
+   };
+
+   template <class M>
+   class TomlSink<M, typename std::enable_if<std::is_floating_point<M>::value>::type> : public TomlFieldSink {
+   public:
+      bool store_float(void *target, double value) const {
+         *static_cast<M *>(target) = static_cast<M>(value);
+         return true;
+      }
+
+      std::string expected() const { return "a float"; }
+   };
+
+   template <>
+   class TomlSink<bool> : public TomlFieldSink {
+   public:
+      bool store_boolean(void *target, bool value) const {
+         *static_cast<bool *>(target) = value;
+         return true;
+      }
+
+      std::string expected() const { return "a boolean"; }
+   };
+
+   template <>
+   class TomlSink<std::string> : public TomlFieldSink {
+   public:
+      bool store_string(void *target, const char *str, size_t len) const {
+         static_cast<std::string *>(target)->assign(str, len);
+         return true;
+      }
+
+      std::string expected() const { return "a string"; }
+   };
+
+   template <class E>
+   class TomlSink<std::vector<E>> : public TomlFieldSink {
+   private:
+      TomlSink<E> element_;
+   public:
+      const TomlFieldSink *element() const { return &element_; }
+      void clear(void *target) const { static_cast<std::vector<E> *>(target)->clear(); }
+
+      void *append(void *target) const {
+         std::vector<E> &array = *static_cast<std::vector<E> *>(target);
+         array.push_back(E());
+         return &array.back();
+      }
+
+      bool append_stored(void *target, StoreElement store, const void *context) const {
+         E value = E();
+         if (!store(&element_, &value, context)) return false;
+
+         static_cast<std::vector<E> *>(target)->push_back(std::move(value));
+         return true;
+      }
+
+      std::string expected() const { return "an array, with each element " + element_.expected(); }
+   };
+
+   // Stores datetimes in a time_t, which is otherwise indistinguishable from an integer
+   class TomlDateTimeSink : public TomlFieldSink {
+   public:
+      bool store_datetime(void *target, time_t value) const {
+         *static_cast<time_t *>(target) = value;
+         return true;
+      }
+
+      std::string expected() const { return "a datetime"; }
+   };
+
+   // The part of binding that does not depend on the struct: follows the parser's
+   // events, resolves keys to fields and reports type errors and missing keys.
+   class TomlBinder : public TomlHandler {
+   public:
+      struct Field {
+         std::string key; // Full key name
+         bool required;
+         std::function<void *(void *)> member; // Returns the member of an object
+         std::shared_ptr<const TomlFieldSink> sink;
+      };
+
+      // Fields in the order they were declared, indexed by the hash of their key
+      class Fields {
+      private:
+         std::vector<Field> fields_;
+         std::vector<std::pair<std::uint64_t, size_t>> index_;
+      public:
+         void add(Field field);
+
+         // Returns the index of the field for key[0, len), or -1
+         int find(const char *key, size_t len) const;
+
+         size_t size() const { return fields_.size(); }
+         const Field &operator[](size_t i) const { return fields_[i]; }
+      };
+   private:
+      TomlParser &parser_;
+      const Fields &fields_;
+      void *object_;
+
+      std::string group_, key_;
+      std::vector<bool> seen_;
+
+      // Where the events for the current value go. A null sink ignores them.
+      struct Frame {
+         const TomlFieldSink *sink;
+         void *target;
+         bool array;
+      };
+      std::vector<Frame> frames_;
+      int field_; // Index of the current key's field, or -1
+      int key_line_;
+
+      // Where each table header is, to report missing keys at their table once
+      // the source may be gone
+      std::unordered_map<std::string, TomlParser::Position> tables_;
+
+      void mismatch();
+
+      // Stores a value through the current frame. Array elements are stored in a
+      // temporary first, so a value that fails leaves the array as it was.
+      template <class F>
+      void store(F store_value) {
+         if (frames_.empty() || !frames_.back().sink) return;
+
+         Frame &frame = frames_.back();
+         bool ok = frame.array ? frame.sink->append_stored(frame.target,
+               [](const TomlFieldSink *sink, void *target, const void *context) {
+                  return (*static_cast<const F *>(context))(sink, target);
+               }, &store_value)
+            : store_value(frame.sink, frame.target);
+         if (!ok) mismatch();
+      }
+   public:
+      TomlBinder(TomlParser &parser, const Fields &fields, void *object);
+
+      void on_table_header(const char *name, size_t len);
+      void on_key(const char *key, size_t len);
+      void on_string(const char *str, size_t len);
+      void on_int(std::int64_t value);
+      void on_float(double value);
+      void on_boolean(bool value);
+      void on_datetime(time_t value);
+      void on_array_begin();
+      void on_array_end();
+
+      // Reports required keys that never appeared, at the header of the table
+      // they belong in, or with no position if it never appeared either. Call
+      // after parsing.
+      void finish();
+   };
+
+   // Maps keys to the members of a struct, so a document can be parsed straight
+   // into it without building a TomlDocument. Each member's type picks how its
+   // value is stored when the schema is declared, so parsing does no type
+   // switching of its own. Declare the mapping once:
+   //
+   //    static const TomlSchema<ServerConfig> kSchema = TomlSchema<ServerConfig>()
+   //       .required("server.host", &ServerConfig::host)
+   //       .required("server.port", &ServerConfig::port)
+   //       .optional("server.tags", &ServerConfig::tags);
+   //
+   // and then parse with kSchema.parse(parser, config). Values are type checked
+   // against their members: a value of the wrong type, an integer that does not
+   // fit, or a missing required key is reported as a TomlError by the parser.
+   // Keys that are not in the schema are ignored, and members whose key is
+   // absent keep their value.
+   template <class T>
+   class TomlSchema {
+   private:
+      TomlBinder::Fields fields_;
+
+      template <class M>
+      TomlSchema &add(const char *key, M T::*member, bool required, std::shared_ptr<const TomlFieldSink> sink) {
+         TomlBinder::Field field;
+         field.key = key;
+         field.required = required;
+         field.member = [member](void *object) -> void * { return &(static_cast<T *>(object)->*member); };
+         field.sink = sink;
+
+         fields_.add(field);
+         return *this;
+      }
+   public:
+      // Bind a key to a member, reporting an error if the key is missing
+      template <class M>
+      TomlSchema &required(const char *key, M T::*member) {
+         return add(key, member, true, std::make_shared<TomlSink<M>>());
+      }
+
+      // Bind a key to a member, leaving the member alone if the key is missing
+      template <class M>
+      TomlSchema &optional(const char *key, M T::*member) {
+         return add(key, member, false, std::make_shared<TomlSink<M>>());
+      }
+
+      // Bind a datetime key to a time_t member
+      TomlSchema &required_datetime(const char *key, time_t T::*member) {
+         return add(key, member, true, std::make_shared<TomlDateTimeSink>());
+      }
+
+      TomlSchema &optional_datetime(const char *key, time_t T::*member) {
+         return add(key, member, false, std::make_shared<TomlDateTimeSink>());
+      }
+
+      // Parse the parser's file, or a buffer, into out. Returns parser.success().
+      bool parse(TomlParser &parser, T &out) const {
+         TomlBinder binder(parser, fields_, &out);
+         parser.parse(binder);
+         binder.finish();
+         return parser.success();
+      }
+
+      bool parse_buffer(TomlParser &parser, const char *data, size_t size, T &out) const {
+         TomlBinder binder(parser, fields_, &out);
+         parser.parse_buffer(data, size, binder);
+         binder.finish();
+         return parser.success();
+      }
+
+      bool parse_buffer(TomlParser &parser, const std::string &source, T &out) const {
+         return parse_buffer(parser, source.data(), source.size(), out);
+      }
+   };
+}
+
+#endif
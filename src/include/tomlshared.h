@@ -0,0 +1,80 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLSHARED_H_
+#define CTOML_SRC_INCLUDE_TOMLSHARED_H_
+
+#include "toml.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace ctoml {
+   // A document shared between many reader threads and occasional writers.
+   //
+   // Readers see immutable snapshots: each version of the document is never
+   // modified once published, so it can be read without any locking. Writers
+   // copy the current version, change the copy and publish it (copying only
+   // the key tables and shared_ptrs; the values themselves are shared).
+   //
+   // Snapshots can be taken with snapshot(), which is safe from any thread.
+   // Threads that read on a hot path should each keep a Reader instead, which
+   // holds on to the latest snapshot and only checks a version counter on each
+   // read, so reads never wait for writers or for each other.
+   class TomlSharedDocument {
+   private:
+      // Only accessed through std::atomic_load and std::atomic_store
+      std::shared_ptr<const TomlDocument> current_;
+
+      // Bumped after each new version is published
+      std::atomic<std::uint64_t> version_;
+
+      // Serialises writers
+      std::mutex write_mutex_;
+
+      TomlSharedDocument(const TomlSharedDocument &) = delete;
+      TomlSharedDocument &operator=(const TomlSharedDocument &) = delete;
+   public:
+      TomlSharedDocument();
+      explicit TomlSharedDocument(TomlDocument doc);
+
+      // Returns the current version of the document
+      std::shared_ptr<const TomlDocument> snapshot() const;
+
+      // Returns the number of versions published so far
+      std::uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+      // Replace the document, e.g. after reloading it
+      void publish(TomlDocument doc);
+
+      // Apply changes to a copy of the current version and publish it. Concurrent
+      // writers are applied one after another.
+      void update(const std::function<void(TomlDocument &)> &change);
+
+      // Set a single key (see TomlDocument::set). Prefer update() to make many changes.
+      bool set(const std::string &key, std::shared_ptr<TomlValue> value);
+
+      // A per-thread view of the document. Not thread safe itself: give each
+      // reading thread its own.
+      class Reader {
+      private:
+         const TomlSharedDocument *shared_;
+         std::shared_ptr<const TomlDocument> snapshot_;
+         std::uint64_t version_;
+      public:
+         explicit Reader(const TomlSharedDocument &shared);
+
+         // Returns the latest version of the document. It remains valid, and
+         // unchanged, until the next call.
+         const TomlDocument &get() {
+            if (shared_->version_.load(std::memory_order_acquire) != version_) refresh();
+            return *snapshot_;
+         }
+
+         // Fetch the latest version
+         void refresh();
+      };
+   };
+}
+
+#endif
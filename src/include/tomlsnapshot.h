@@ -0,0 +1,157 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLSNAPSHOT_H_
+#define CTOML_SRC_INCLUDE_TOMLSNAPSHOT_H_
+
+#include "toml.h"
+#include "tomlfile.h"
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+
+namespace ctoml {
+   // A value inside a snapshot image. Like TomlCompactValue it packs into 16
+   // bytes, but strings and array elements are found at an offset from the value
+   // itself rather than through a pointer, so the image can be mapped anywhere
+   // and read in place.
+   class TomlSnapshotValue {
+   private:
+      std::uint8_t type_; // A TomlType
+      std::uint8_t reserved_[3];
+      std::uint32_t size_; // Length of a string or array
+
+      union {
+         std::int64_t int_;
+         double float_;
+         std::int64_t boolean_;
+         std::int64_t datetime_;
+         std::int64_t offset_; // From this value to a string or the first array element
+      };
+
+      const char *at_offset() const { return reinterpret_cast<const char *>(this) + offset_; }
+
+      friend class TomlSnapshot;
+   public:
+      // Returns the type of this TOML value
+      TomlType type() const { return static_cast<TomlType>(type_); }
+
+      // Typed reads. A value of another type reads as zero (or empty).
+      std::int64_t int_value() const { return type() == TomlType::Int ? int_ : 0; }
+      double float_value() const { return type() == TomlType::Float ? float_ : 0.0; }
+      bool bool_value() const { return type() == TomlType::Boolean && boolean_; }
+      time_t datetime_value() const { return type() == TomlType::DateTime ? static_cast<time_t>(datetime_) : 0; }
+
+      // String contents (not null terminated) and length
+      const char *string_data() const { return type() == TomlType::String ? at_offset() : ""; }
+      std::string string_value() const { return std::string(string_data(), size()); }
+
+      // Number of characters in a string or elements in an array
+      size_t size() const { return (type() == TomlType::String || type() == TomlType::Array) ? size_ : 0; }
+
+      // Array element access
+      const TomlSnapshotValue &operator[](size_t index) const { return begin()[index]; }
+      const TomlSnapshotValue *begin() const {
+         return type() == TomlType::Array ? reinterpret_cast<const TomlSnapshotValue *>(at_offset()) : nullptr;
+      }
+      const TomlSnapshotValue *end() const { return begin() + size(); }
+
+      // Convert the value to a primitive type, like toml_value_cast
+      template <class T>
+      T as() const {
+         switch (type()) {
+            case TomlType::Boolean: return static_cast<T>(boolean_ != 0);
+            case TomlType::Int: return static_cast<T>(int_);
+            case TomlType::Float: return static_cast<T>(float_);
+            case TomlType::DateTime: return static_cast<T>(datetime_);
+            default: return T();
+         }
+      }
+   };
+
+   template <>
+   inline std::string TomlSnapshotValue::as<std::string>() const {
+      return string_value();
+   }
+
+   static_assert(sizeof(TomlSnapshotValue) == 16, "TomlSnapshotValue should pack into 16 bytes");
+
+   // A parsed document saved as a binary image, so that a large file that rarely
+   // changes does not have to be parsed again every time a program starts.
+   //
+   // The image records the format version, the byte order and a hash of the TOML
+   // text it was made from. Opening it maps the file and checks those against the
+   // current source, so a stale or foreign snapshot is rejected and the caller can
+   // fall back to parsing. Values are then read straight out of the mapping.
+   //
+   // The source check is its size and a 64-bit hash of all of it (toml_hash_bytes),
+   // so an edit is missed only if the edited text has the same size and hash. That
+   // does not happen by accident, but the check is no defence against text
+   // crafted to collide, so don't rely on it where the source is untrusted.
+   //
+   // Snapshots are a cache, not an interchange format: they are only readable on
+   // machines with the same byte order.
+   class TomlSnapshot {
+   public:
+      // Bumped whenever the layout changes
+      static const std::uint32_t kVersion = 2;
+   private:
+      struct Header;
+      struct Key;
+
+      std::shared_ptr<TomlMappedFile> file_;
+      const Header *header_;
+      const Key *keys_;
+      const std::uint32_t *index_; // Key numbers sorted by the hash of their name
+      const TomlSnapshotValue *values_;
+      const char *strings_;
+
+      // Checks the layout of a mapped image, and that every offset stays inside it
+      bool validate();
+
+      std::shared_ptr<TomlValue> make_value(TomlArena &arena, const TomlSnapshotValue &value) const;
+   public:
+      TomlSnapshot();
+
+      // Write doc, which was parsed from source[0, size), to a snapshot file. The
+      // file is written under a temporary name and renamed into place, so readers
+      // never see it half written. Returns false if it could not be written.
+      static bool save(const TomlDocument &doc, const char *source, size_t size, const std::string &filename);
+      static bool save(const TomlDocument &doc, const std::string &source, const std::string &filename);
+
+      // Map a snapshot file. Returns false, leaving the snapshot closed, if it
+      // cannot be read, is not a snapshot of this version or byte order, or was
+      // not made from exactly source[0, size).
+      bool open(const std::string &filename, const char *source, size_t size);
+      bool open(const std::string &filename, const std::string &source);
+
+      // Unmap the file
+      void close();
+
+      // Returns true if a snapshot is open
+      bool good() const { return header_ != nullptr; }
+
+      // Returns the number of keys
+      size_t size() const;
+
+      // Returns the full key name and value of the i-th key, in the order they
+      // were in the document
+      std::string key(size_t i) const;
+      const TomlSnapshotValue &value(size_t i) const;
+
+      // Returns the value for a key, or nullptr if there is no such key
+      const TomlSnapshotValue *get(const char *key, size_t len) const;
+      const TomlSnapshotValue *get(const std::string &key) const { return get(key.data(), key.size()); }
+
+      template <class T>
+      T get_as(const std::string &key) const {
+         const TomlSnapshotValue *value = get(key);
+         return value ? value->as<T>() : T();
+      }
+
+      // Build a TomlDocument holding the snapshot's values. They are allocated
+      // from an arena, and no TOML text is parsed.
+      TomlDocument to_document() const;
+   };
+}
+
+#endif
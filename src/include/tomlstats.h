@@ -0,0 +1,102 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLSTATS_H_
+#define CTOML_SRC_INCLUDE_TOMLSTATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Build the library with -DCTOML_ENABLE_STATS=1 to have the parser count what it
+// does and time each phase. Otherwise the instrumentation compiles to nothing
+// and TomlParser::stats() is always zero.
+#ifndef CTOML_ENABLE_STATS
+#define CTOML_ENABLE_STATS 0
+#endif
+
+// Wraps statements that only exist in instrumented builds
+#if CTOML_ENABLE_STATS
+#define CTOML_STATS(...) __VA_ARGS__
+#else
+#define CTOML_STATS(...)
+#endif
+
+namespace ctoml {
+   // What a parser did while parsing a document (see TomlParser::stats). When a
+   // document is parsed on several threads the counts and times of every thread
+   // are added together, so times can exceed the wall clock time.
+   struct TomlParseStats {
+      // Returns true if the library was built with CTOML_ENABLE_STATS
+      static bool enabled();
+
+      // Bytes of source the lexer moved over
+      std::uint64_t bytes_scanned;
+
+      // Tokens of each type
+      std::uint64_t tables; // Key group headers
+      std::uint64_t keys;
+      std::uint64_t strings;
+      std::uint64_t ints;
+      std::uint64_t floats;
+      std::uint64_t booleans;
+      std::uint64_t datetimes;
+      std::uint64_t arrays;
+
+      // Values allocated while building a document, and their size including
+      // string contents and unboxed array elements
+      std::uint64_t allocations;
+      std::uint64_t bytes_allocated;
+
+      // Nanoseconds spent in each phase
+      std::uint64_t open_ns; // Opening and mapping the file
+      std::uint64_t parse_ns; // The whole parse, including the phases below
+      std::uint64_t string_ns; // Reading strings and unescaping them
+      std::uint64_t value_ns; // Allocating values
+      std::uint64_t insert_ns; // Inserting keys and checking for duplicates
+
+      TomlParseStats() : bytes_scanned(0), tables(0), keys(0), strings(0), ints(0), floats(0),
+         booleans(0), datetimes(0), arrays(0), allocations(0), bytes_allocated(0), open_ns(0),
+         parse_ns(0), string_ns(0), value_ns(0), insert_ns(0) { }
+
+      void clear() { *this = TomlParseStats(); }
+
+      // Adds another parse's counts and times to these
+      TomlParseStats &operator+=(const TomlParseStats &other) {
+         bytes_scanned += other.bytes_scanned;
+         tables += other.tables;
+         keys += other.keys;
+         strings += other.strings;
+         ints += other.ints;
+         floats += other.floats;
+         booleans += other.booleans;
+         datetimes += other.datetimes;
+         arrays += other.arrays;
+         allocations += other.allocations;
+         bytes_allocated += other.bytes_allocated;
+         open_ns += other.open_ns;
+         parse_ns += other.parse_ns;
+         string_ns += other.string_ns;
+         value_ns += other.value_ns;
+         insert_ns += other.insert_ns;
+         return *this;
+      }
+   };
+
+   // Adds the time from its construction until stop() (or destruction) to a counter
+   class TomlStatsTimer {
+   private:
+      typedef std::chrono::steady_clock clock;
+
+      std::uint64_t *counter_;
+      clock::time_point start_;
+   public:
+      explicit TomlStatsTimer(std::uint64_t &counter) : counter_(&counter), start_(clock::now()) { }
+      ~TomlStatsTimer() { stop(); }
+
+      void stop() {
+         if (!counter_) return;
+         *counter_ += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count();
+         counter_ = nullptr;
+      }
+   };
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLTABLE_H_
+#define CTOML_SRC_INCLUDE_TOMLTABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ctoml {
+   // Compile-time version of TomlTable::hash (64 bit FNV-1a)
+   constexpr std::uint64_t toml_key_hash(const char *str, size_t len,
+      std::uint64_t h = 14695981039346656037ULL) {
+      return len == 0 ? h : toml_key_hash(str + 1, len - 1,
+         (h ^ static_cast<unsigned char>(*str)) * 1099511628211ULL);
+   }
+
+   // One level of a document's key hierarchy. Each entry is either a value, held
+   // as the index of its slot in the owning TomlDocument, or a nested table.
+   //
+   // Entries are kept in insertion order. Small tables are searched linearly; larger
+   // ones also keep an open addressing hash index. Lookups take a pointer and length,
+   // so a path can be resolved segment by segment without copying it.
+   class TomlTable {
+   public:
+      static const size_t npos = static_cast<size_t>(-1);
+
+      struct Entry {
+         std::string name;
+
+         // Index of the value in the document, or npos for a table
+         size_t slot;
+
+         // The nested table, or nullptr for a value
+         std::unique_ptr<TomlTable> table;
+
+         bool is_table() const { return table != nullptr; }
+      };
+
+      typedef std::vector<Entry>::const_iterator const_iterator;
+   private:
+      std::vector<Entry> entries_;
+
+      // Hash index into entries_ (entry index + 1, or 0 for an empty bucket).
+      // Only built once the table outgrows a linear scan.
+      std::vector<std::uint32_t> buckets_;
+
+      void rehash(size_t num_buckets);
+      size_t find_index(const char *name, size_t len) const;
+   public:
+      TomlTable() { }
+      TomlTable(const TomlTable &other);
+      TomlTable &operator=(const TomlTable &other);
+      TomlTable(TomlTable &&) = default;
+      TomlTable &operator=(TomlTable &&) = default;
+
+      // Hash used for key segments (64 bit FNV-1a)
+      static std::uint64_t hash(const char *str, size_t len);
+
+      // Returns the entry with a name, or nullptr
+      const Entry *find(const char *name, size_t len) const;
+      Entry *find(const char *name, size_t len);
+
+      // Adds an entry. The name must not already be in the table.
+      Entry &add(const char *name, size_t len);
+
+      // Iterate through the entries in insertion order
+      const_iterator begin() const { return entries_.begin(); }
+      const_iterator end() const { return entries_.end(); }
+
+      // Returns the number of entries
+      size_t size() const { return entries_.size(); }
+   };
+}
+
+#endif
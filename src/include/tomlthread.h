@@ -0,0 +1,18 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLTHREAD_H_
+#define CTOML_SRC_INCLUDE_TOMLTHREAD_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace ctoml {
+   // Returns the number of threads to use when the caller asks for 0
+   unsigned toml_default_threads();
+
+   // Calls task(i) for every i in [0, count) on up to num_threads threads (0 picks
+   // toml_default_threads()). The calling thread takes part, and tasks are handed out
+   // one at a time from a shared counter so that uneven tasks still balance.
+   // Returns once every task has finished.
+   void toml_parallel_for(size_t count, unsigned num_threads, const std::function<void(size_t)> &task);
+}
+
+#endif
@@ -1,11 +1,15 @@
 #ifndef CTOML_SRC_INCLUDE_TOMLVALUE_H_
 #define CTOML_SRC_INCLUDE_TOMLVALUE_H_
 
+#include "tomlmemory.h"
+
 #include <cstdint>
 #include <ctime>
 #include <cstddef>
+#include <iterator>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <memory>
 
@@ -17,6 +21,7 @@ namespace ctoml {
    };
 
    class TomlArray; // Forward declaration needed by TomlValue::create_array
+   class TomlArena;
 
    // Defines the abstract class for a TOML primitive.
    class TomlValue {
@@ -25,6 +30,9 @@ namespace ctoml {
    public:
       TomlValue(TomlType type);
 
+      // Values are deleted through TomlValue pointers
+      virtual ~TomlValue() { }
+
       // Returns the type of this TOML value
       TomlType type() const;
 
@@ -34,6 +42,7 @@ namespace ctoml {
       static std::unique_ptr<TomlValue> create_float(double val);
       static std::unique_ptr<TomlValue> create_boolean(bool val);
       static std::unique_ptr<TomlValue> create_datetime(tm val);
+      static std::unique_ptr<TomlValue> create_datetime(time_t val);
 
       static std::unique_ptr<TomlValue> create_array();
 
@@ -56,13 +65,20 @@ namespace ctoml {
 
    class TomlString : public TomlValue {
    private:
-      std::string val_;
+      std::basic_string<char, std::char_traits<char>, TomlAllocator<char>> val_;
    public:
       explicit TomlString(std::string val);
 
+      // Create a string whose characters are stored in resource
+      TomlString(const char *str, size_t len, TomlMemoryResource *resource);
+
       // Returns the string value
       std::string value() const;
 
+      // Read the characters in place, without copying them
+      const char *data() const { return val_.data(); }
+      size_t size() const { return val_.size(); }
+
       bool equals(std::string val) const;
       bool equals(const char *val) const;
 
@@ -114,7 +130,9 @@ namespace ctoml {
    private:
       time_t val_;
    public:
+      // Broken down time is taken to be in UTC
       explicit TomlDateTime(tm val);
+      explicit TomlDateTime(time_t val);
 
       // Returns the time value
       time_t value() const;
@@ -122,43 +140,148 @@ namespace ctoml {
       std::string to_string() const;
    };
 
-   // Cast a shared_ptr of a TomlValue into its primitive type
+   // Cast a TomlValue into its primitive type
    template <class T>
-   T toml_value_cast(std::shared_ptr<TomlValue> value) {
-      if (value->type() == TomlType::Boolean)
-         return static_cast<T>(std::static_pointer_cast<TomlBoolean>(value)->value());
-      else if (value->type() == TomlType::Int)
-         return static_cast<T>(std::static_pointer_cast<TomlInt>(value)->value());
-      else if (value->type() == TomlType::Float)
-         return static_cast<T>(std::static_pointer_cast<TomlFloat>(value)->value());
-      else if (value->type() == TomlType::DateTime)
-         return static_cast<T>(std::static_pointer_cast<TomlDateTime>(value)->value());
+   T toml_value_cast(const TomlValue &value) {
+      if (value.type() == TomlType::Boolean)
+         return static_cast<T>(static_cast<const TomlBoolean &>(value).value());
+      else if (value.type() == TomlType::Int)
+         return static_cast<T>(static_cast<const TomlInt &>(value).value());
+      else if (value.type() == TomlType::Float)
+         return static_cast<T>(static_cast<const TomlFloat &>(value).value());
+      else if (value.type() == TomlType::DateTime)
+         return static_cast<T>(static_cast<const TomlDateTime &>(value).value());
       return T();
    }
 
    // Template specialization for std::string
    template <>
-   inline std::string toml_value_cast<std::string>(std::shared_ptr<TomlValue> value) {
-      return std::static_pointer_cast<TomlString>(value)->value();
+   inline std::string toml_value_cast<std::string>(const TomlValue &value) {
+      return static_cast<const TomlString &>(value).value();
+   }
+
+   // Cast a shared_ptr of a TomlValue into its primitive type
+   template <class T>
+   T toml_value_cast(const std::shared_ptr<TomlValue> &value) {
+      return toml_value_cast<T>(*value);
    }
 
+   // A view of contiguous elements, like std::span
+   template <class T>
+   class TomlSpan {
+   private:
+      T *data_;
+      size_t size_;
+   public:
+      TomlSpan() : data_(nullptr), size_(0) { }
+      TomlSpan(T *data, size_t size) : data_(data), size_(size) { }
+
+      T *data() const { return data_; }
+      size_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+
+      T &operator[](size_t index) const { return data_[index]; }
+      T *begin() const { return data_; }
+      T *end() const { return data_ + size_; }
+   };
+
    class TomlArray : public TomlValue {
    private:
-      std::vector<std::shared_ptr<TomlValue>> array_;
+      // Arrays of integers, floats or booleans keep their elements unboxed, in
+      // one contiguous vector. Anything else, including an array that mixes
+      // types, holds a TomlValue per element.
+      enum class Storage : std::uint8_t { Values, Ints, Floats, Booleans };
+      Storage storage_;
+
+      // Elements are stored in the array's memory resource
+      template <class T>
+      using Vector = std::vector<T, TomlAllocator<T>>;
+
+      Vector<std::shared_ptr<TomlValue>> array_;
+      Vector<std::int64_t> ints_;
+      Vector<double> floats_;
+      Vector<std::uint8_t> booleans_; // 0 or 1
+
+      // The arena the array was made in, if any. Elements from the same arena are
+      // held without a reference to it, so that the arena does not keep itself
+      // alive, and share ownership of it again when they are read.
+      std::weak_ptr<TomlArena> arena_;
+      friend class TomlArena;
+
+      // Returns the pointer to store for an element
+      std::shared_ptr<TomlValue> hold(std::shared_ptr<TomlValue> v) const;
+
+      // Move unboxed elements into array_, before adding an element of another type
+      void box();
+
+      // Create a value for an element in the array's memory resource
+      template <class T, class V>
+      std::shared_ptr<TomlValue> make_element(V value) const {
+         return std::allocate_shared<T>(TomlAllocator<T>(resource()), value);
+      }
+
+      // Converts an unboxed element, like toml_value_cast
+      template <class T, class V>
+      static T element_as(V value, std::true_type) { return static_cast<T>(value); }
+
+      template <class T, class V>
+      static T element_as(V, std::false_type) { return T(); }
    public:
-      typedef std::vector<std::shared_ptr<TomlValue>>::const_iterator const_iterator;
+      // Iterates through the elements as TomlValues. Unboxed elements are boxed
+      // on the heap as they are read, so *it returns a shared_ptr by value.
+      class const_iterator {
+      private:
+         const TomlArray *array_;
+         size_t index_;
+
+         struct Arrow {
+            std::shared_ptr<TomlValue> value;
+            const std::shared_ptr<TomlValue> *operator->() const { return &value; }
+         };
+      public:
+         typedef std::random_access_iterator_tag iterator_category;
+         typedef std::shared_ptr<TomlValue> value_type;
+         typedef std::ptrdiff_t difference_type;
+         typedef const std::shared_ptr<TomlValue> *pointer;
+         typedef std::shared_ptr<TomlValue> reference;
+
+         const_iterator(const TomlArray *array, size_t index) : array_(array), index_(index) { }
+
+         std::shared_ptr<TomlValue> operator*() const { return array_->at(static_cast<int>(index_)); }
+         Arrow operator->() const { Arrow arrow = { **this }; return arrow; }
+
+         const_iterator &operator++() { ++index_; return *this; }
+         const_iterator operator++(int) { const_iterator old = *this; ++index_; return old; }
+         const_iterator &operator--() { --index_; return *this; }
+         const_iterator &operator+=(difference_type n) { index_ += n; return *this; }
+         const_iterator operator+(difference_type n) const { return const_iterator(array_, index_ + n); }
+         difference_type operator-(const const_iterator &other) const {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+         }
 
-      // Create empty TOML array
-      TomlArray();
+         bool operator==(const const_iterator &other) const { return index_ == other.index_; }
+         bool operator!=(const const_iterator &other) const { return index_ != other.index_; }
+         bool operator<(const const_iterator &other) const { return index_ < other.index_; }
+      };
+
+      // Create empty TOML array, whose elements are stored in resource
+      explicit TomlArray(TomlMemoryResource *resource = toml_default_resource());
 
       // Create a TOML array from iterators
       template <typename InputIterator>
-      TomlArray(InputIterator begin, InputIterator end) : array_(begin, end) { }
+      TomlArray(InputIterator begin, InputIterator end) : TomlArray() {
+         for (; begin != end; ++begin) add(std::shared_ptr<TomlValue>(*begin));
+      }
 
       // Add values to the TOML array
       void add(std::unique_ptr<TomlValue> v);
       void add(std::shared_ptr<TomlValue> v);
 
+      // Add primitive values without creating a TomlValue for them
+      void add_int(std::int64_t value);
+      void add_float(double value);
+      void add_boolean(bool value);
+
       // Iterate through the TOML array
       const_iterator cbegin() const;
       const_iterator cend() const;
@@ -167,18 +290,43 @@ namespace ctoml {
       template <class T>
       std::vector<T> as_vector() const {
          std::vector<T> list;
-
-         for (auto it = cbegin(); it != cend(); ++it) {
-            list.push_back(toml_value_cast<T>(it));
+         list.reserve(size());
+
+         // Unboxed elements are converted straight from their storage
+         switch (storage_) {
+            case Storage::Ints:
+               for (auto value : ints_) list.push_back(element_as<T>(value, std::is_arithmetic<T>()));
+               break;
+            case Storage::Floats:
+               for (auto value : floats_) list.push_back(element_as<T>(value, std::is_arithmetic<T>()));
+               break;
+            case Storage::Booleans:
+               for (auto value : booleans_) list.push_back(element_as<T>(value != 0, std::is_arithmetic<T>()));
+               break;
+            case Storage::Values:
+               for (auto &value : array_) list.push_back(toml_value_cast<T>(*value));
+               break;
          }
 
          return list;
       }
 
+      // Read the elements of an array of integers, floats or booleans in place.
+      // Each returns an empty span if the array holds anything else. Booleans are
+      // stored a byte each, as 0 or 1.
+      TomlSpan<const std::int64_t> int_span() const;
+      TomlSpan<const double> float_span() const;
+      TomlSpan<const std::uint8_t> bool_span() const;
+
       // Get the size of the array
-      size_t size() const { return array_.size(); }
+      size_t size() const;
+
+      // Returns the resource the elements are stored in
+      TomlMemoryResource *resource() const { return array_.get_allocator().resource(); }
 
-      // Random access
+      // Random access. Unboxed elements are returned as a new TomlValue on the
+      // heap, so reading never allocates from the array's resource. Use the
+      // spans to read them without allocating at all.
       std::shared_ptr<TomlValue> at(const int index = 0) const;
       std::shared_ptr<TomlValue> operator[] (const int index) const;
 
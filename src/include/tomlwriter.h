@@ -0,0 +1,58 @@
+#ifndef CTOML_SRC_INCLUDE_TOMLWRITER_H_
+#define CTOML_SRC_INCLUDE_TOMLWRITER_H_
+
+#include "toml.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ctoml {
+   // Serialises documents as TOML. Root keys come first, followed by each key
+   // group in lexicographical order, with the keys of a group sorted too.
+   // Strings are quoted and escaped, and floats are written with enough digits
+   // to read back exactly.
+   //
+   // Output is appended to a buffer owned by the writer, which is reused from
+   // one document to the next, so keep a writer around to serialise many.
+   class TomlWriter {
+   private:
+      std::string buffer_;
+
+      // Slots of the document being written, in output order
+      struct Item {
+         const char *key;
+         std::uint32_t size;
+         std::uint32_t group_size; // Length of the key group's name, or 0 for root keys
+         std::uint32_t group; // Index into groups_, then the group's position in the output
+         const TomlValue *value;
+      };
+      std::vector<Item> items_;
+
+      // Runs of consecutive slots in the same key group
+      struct Group {
+         const char *name;
+         std::uint32_t size;
+         std::uint32_t rank;
+      };
+      std::vector<Group> groups_;
+      std::vector<std::uint32_t> order_;
+
+      void append_value(const TomlValue &value);
+      void append_string(const char *str, size_t len);
+      void append_int(std::int64_t value);
+      void append_float(double value);
+   public:
+      // Serialise doc, replacing the buffer's contents. Returns the buffer.
+      const std::string &write(const TomlDocument &doc);
+
+      // Serialise doc to a stream, without flushing it
+      std::ostream &write(const TomlDocument &doc, std::ostream &out);
+
+      // Returns the output of the last write
+      const std::string &buffer() const { return buffer_; }
+   };
+}
+
+#endif
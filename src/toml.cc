@@ -1,12 +1,76 @@
 #include "include/toml.h"
+#include "include/tomllazy.h"
+#include "include/tomldiff.h"
+#include "include/tomlwriter.h"
+#include "include/tomlthread.h"
+#include "include/tomlscan.h"
+#include "include/tomlnumber.h"
+#include "include/tomldatetime.h"
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <vector>
-#include <map>
 #include <iostream>
 
 using namespace ctoml;
 
+// Documents smaller than this are always parsed on one thread
+static const size_t kMinParallelSize = 64 * 1024;
+
+// Longest text kept for an error message
+static const size_t kMaxErrorText = 1000;
+
+// Returns true if anything but whitespace and comments follows the line holding p
+static bool more_entries(const char *p, const char *end) {
+   p = toml_find_newline(p, end);
+   while ((p = toml_skip_spaces(p, end)) < end && *p == '#') p = toml_find_newline(p, end);
+
+   return p < end;
+}
+
+// Reads the code point of a \u or \U escape from the hex digits at p. Surrogates and
+// values past U+10FFFF are not characters, so they are not valid escapes.
+static bool read_unicode_escape(const char *p, const char *end, int digits, std::uint32_t *code) {
+   if (end - p < digits) return false;
+
+   std::uint32_t value = 0;
+   for (int i = 0; i < digits; i++) {
+      char c = p[i];
+      if (c >= '0' && c <= '9') value = value << 4 | (c - '0');
+      else if (c >= 'a' && c <= 'f') value = value << 4 | (c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') value = value << 4 | (c - 'A' + 10);
+      else return false;
+   }
+
+   if ((value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF) return false;
+   *code = value;
+   return true;
+}
+
+// Returns the number of bytes code takes in UTF-8
+static int utf8_length(std::uint32_t code) {
+   return code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+}
+
+static void append_utf8(std::string &out, std::uint32_t code) {
+   int len = utf8_length(code);
+   if (len == 1) {
+      out += static_cast<char>(code);
+      return;
+   }
+
+   // The lead byte has len high bits set, then each continuation byte holds six bits
+   static const unsigned char kLead[5] = { 0, 0, 0xC0, 0xE0, 0xF0 };
+   out += static_cast<char>(kLead[len] | (code >> (6 * (len - 1))));
+   for (int i = len - 2; i >= 0; i--) out += static_cast<char>(0x80 | ((code >> (6 * i)) & 0x3F));
+}
+
+bool TomlParseStats::enabled() {
+   return CTOML_ENABLE_STATS != 0;
+}
+
 TomlDocument::const_iterator TomlDocument::cbegin() const {
    return values_.cbegin();
 }
@@ -15,24 +79,166 @@ TomlDocument::const_iterator TomlDocument::cend() const {
    return values_.cend();
 }
 
-void TomlDocument::insert(std::string key, std::shared_ptr<TomlValue> value) {
-   values_.emplace(key, value);
+size_t TomlDocument::find_slot(const char *key, size_t len) const {
+   const TomlTable *table = &root_;
+   const char *end = key + len;
+
+   for (;;) {
+      const char *dot = static_cast<const char *>(memchr(key, '.', end - key));
+      const TomlTable::Entry *entry = table->find(key, (dot ? dot : end) - key);
+
+      if (!entry) return TomlTable::npos;
+      if (!dot) return entry->slot;
+      if (!entry->table) return TomlTable::npos;
+
+      table = entry->table.get();
+      key = dot + 1;
+   }
+}
+
+TomlTable *TomlDocument::make_tables(TomlTable *table, const char *key, size_t len, size_t *conflict) {
+   const char *start = key, *end = key + len;
+
+   for (;;) {
+      const char *dot = static_cast<const char *>(memchr(key, '.', end - key));
+      const char *segment_end = dot ? dot : end;
+
+      TomlTable::Entry *entry = table->find(key, segment_end - key);
+      if (!entry) {
+         entry = &table->add(key, segment_end - key);
+         entry->table.reset(new TomlTable());
+      } else if (!entry->table) {
+         if (conflict) *conflict = segment_end - start;
+         return nullptr;
+      }
+
+      table = entry->table.get();
+      if (!dot) return table;
+      key = dot + 1;
+   }
 }
 
-void TomlDocument::insert(std::string key, std::unique_ptr<TomlValue> value) {
-   insert(key, std::shared_ptr<TomlValue>(move(value)));
+void TomlDocument::add_value(TomlTable *table, const char *name, size_t len,
+   const std::string &full_key, std::shared_ptr<TomlValue> value) {
+   size_t slot = values_.size();
+   table->add(name, len).slot = slot;
+   values_.push_back(value_type(full_key, value));
+
+   // Keep the load factor of the path index at or below one half
+   if (values_.size() * 2 > path_index_.size()) {
+      PathIndexEntry empty = { 0, TomlTable::npos };
+      path_index_.assign(path_index_.empty() ? 16 : path_index_.size() * 2, empty);
+
+      for (size_t i = 0; i < values_.size(); i++) {
+         index_path(TomlTable::hash(values_[i].first.data(), values_[i].first.size()), i);
+      }
+   } else {
+      index_path(TomlTable::hash(full_key.data(), full_key.size()), slot);
+   }
 }
 
-void TomlDocument::set(std::string key, std::shared_ptr<TomlValue> value) {
-   values_[key] = value;
+void TomlDocument::index_path(std::uint64_t hash, size_t slot) {
+   size_t mask = path_index_.size() - 1;
+   size_t b = hash & mask;
+   while (path_index_[b].slot != TomlTable::npos) b = (b + 1) & mask;
+
+   path_index_[b].hash = hash;
+   path_index_[b].slot = slot;
 }
 
-void TomlDocument::set(std::string key, std::unique_ptr<TomlValue> value) {
-   set(key, std::shared_ptr<TomlValue>(move(value)));
+size_t TomlDocument::find_path(const char *key, size_t len, std::uint64_t hash) const {
+   if (path_index_.empty()) return TomlTable::npos;
+
+   size_t mask = path_index_.size() - 1;
+   for (size_t b = hash & mask; path_index_[b].slot != TomlTable::npos; b = (b + 1) & mask) {
+      const PathIndexEntry &entry = path_index_[b];
+      if (entry.hash != hash) continue;
+
+      const std::string &full_key = values_[entry.slot].first;
+      if (full_key.size() == len && memcmp(full_key.data(), key, len) == 0) return entry.slot;
+   }
+
+   return TomlTable::npos;
 }
 
-bool TomlDocument::is_key(std::string key) const {
-   return values_.find(key) != values_.end();
+const TomlDocument::Section *TomlDocument::find_section(std::uint64_t hash, const char *text, size_t size) const {
+   Section key = { hash, 0, 0, 0, 0 };
+
+   // The hash only finds candidates; the text must match exactly
+   auto it = std::lower_bound(sections_.begin(), sections_.end(), key);
+   for (; it != sections_.end() && it->hash == hash; ++it) {
+      if (it->size == size && memcmp(source_->data() + it->offset, text, size) == 0) return &*it;
+   }
+
+   return nullptr;
+}
+
+bool TomlDocument::insert_or_set(const std::string &key, std::shared_ptr<TomlValue> value, bool replace) {
+   // The document no longer matches its source
+   sections_.clear();
+   source_ = nullptr;
+
+   TomlTable *table = &root_;
+
+   size_t dot = key.rfind('.');
+   size_t name_pos = 0;
+   if (dot != std::string::npos) {
+      table = make_tables(table, key.data(), dot);
+      if (!table) return false;
+      name_pos = dot + 1;
+   }
+
+   TomlTable::Entry *entry = table->find(key.data() + name_pos, key.size() - name_pos);
+   if (!entry) {
+      add_value(table, key.data() + name_pos, key.size() - name_pos, key, value);
+      return true;
+   }
+
+   if (entry->is_table() || !replace) return false;
+
+   values_[entry->slot].second = value;
+   return true;
+}
+
+bool TomlDocument::insert(std::string key, std::shared_ptr<TomlValue> value) {
+   return insert_or_set(key, value, false);
+}
+
+bool TomlDocument::insert(std::string key, std::unique_ptr<TomlValue> value) {
+   return insert(key, std::shared_ptr<TomlValue>(move(value)));
+}
+
+bool TomlDocument::set(std::string key, std::shared_ptr<TomlValue> value) {
+   return insert_or_set(key, value, true);
+}
+
+bool TomlDocument::set(std::string key, std::unique_ptr<TomlValue> value) {
+   return set(key, std::shared_ptr<TomlValue>(move(value)));
+}
+
+bool TomlDocument::is_key(const std::string &key) const {
+   return find_slot(key.data(), key.size()) != TomlTable::npos;
+}
+
+bool TomlDocument::is_key(const char *key) const {
+   return find_slot(key, strlen(key)) != TomlTable::npos;
+}
+
+const TomlTable *TomlDocument::get_table(std::string key) const {
+   if (key.empty()) return &root_;
+
+   const TomlTable *table = &root_;
+   const char *cur = key.data(), *end = key.data() + key.size();
+
+   for (;;) {
+      const char *dot = static_cast<const char *>(memchr(cur, '.', end - cur));
+      const TomlTable::Entry *entry = table->find(cur, (dot ? dot : end) - cur);
+      if (!entry || !entry->table) return nullptr;
+
+      table = entry->table.get();
+      if (!dot) return table;
+      cur = dot + 1;
+   }
 }
 
 void TomlDocument::Print() const
@@ -43,151 +249,218 @@ void TomlDocument::Print() const
        std::cout << "    " << it->first << ": " << it->second->to_string() << std::endl;
    }
 }
-std::shared_ptr<TomlValue> TomlDocument::get(std::string key) const {
-   return is_key(key) ? values_.find(key)->second : nullptr;
+const TomlValue *TomlDocument::find(const char *key, size_t len) const {
+   size_t slot = find_slot(key, len);
+   return slot != TomlTable::npos ? values_[slot].second.get() : nullptr;
 }
 
-std::ostream &TomlDocument::write(std::ostream &out) {
-   // Sort key groups by key in lexographical order (but putting those with root key in front)
-   std::map<std::string, std::shared_ptr<TomlValue>> map;
+std::shared_ptr<TomlValue> TomlDocument::get(const std::string &key) const {
+   size_t slot = find_slot(key.data(), key.size());
+   return slot != TomlTable::npos ? values_[slot].second : nullptr;
+}
 
-   // Add each key to the map to sort it
-   for (auto it = cbegin(); it != cend(); ++it) {
-      if (it->first.find(".") == std::string::npos) {
-         map.insert(std::make_pair("." + it->first, it->second));
-      } else {
-         map.insert(std::make_pair(it->first, it->second));
-      }
-   }
+std::shared_ptr<TomlValue> TomlDocument::get(const char *key) const {
+   size_t slot = find_slot(key, strlen(key));
+   return slot != TomlTable::npos ? values_[slot].second : nullptr;
+}
 
-   // Write each key group
-   std::string prevPrefix, prefix, suffix;
-   for (auto it = map.cbegin(); it != map.cend(); ++it) {
-      // Get the value of this key (TODO: escape the value e.g. convert '\n' to '\\n')
-      std::string value = it->second->to_string();
+std::ostream &TomlDocument::write(std::ostream &out) const {
+   TomlWriter writer;
+   return writer.write(*this, out);
+}
 
-      // Get the key without the last '.' 
-      auto pos = it->first.rfind(".");
-      if (pos != std::string::npos) {
-         prefix = it->first.substr(0, pos);
-         suffix = it->first.substr(pos + 1);
+TomlParser::TomlParser() : begin_(nullptr), pos_(nullptr), end_(nullptr), cur_line_(0),
+   use_arena_(false), resource_(toml_default_resource()), num_threads_(1), max_errors_(0),
+   depth_(0), num_keys_(0), stopped_(false), hit_max_errors_(false) {
 
-         // If this is a different key group
-         if (prevPrefix != prefix) {
-            // Write the key prefix
-            out << "[" << prefix << "]" << std::endl;
-         }
-      } else {
-         prefix = "";
-         suffix = it->first;
-      }
+}
 
-      // Write out the contents of this key
-      out << suffix << " = " << value << std::endl;
-      prevPrefix = prefix;
-   }
+TomlParser::TomlParser(std::string filename) : begin_(nullptr), pos_(nullptr), end_(nullptr),
+   cur_line_(0), use_arena_(false), resource_(toml_default_resource()), num_threads_(1), max_errors_(0),
+   depth_(0), num_keys_(0), stopped_(false), hit_max_errors_(false) {
+   this->open(filename);
+}
+
+std::shared_ptr<TomlArena> TomlParser::make_arena() const {
+   if (!use_arena_) return nullptr;
 
-   return out; 
+   // The arena object itself comes from the resource too
+   return std::allocate_shared<TomlArena>(TomlAllocator<TomlArena>(resource_), resource_);
 }
 
-TomlParser::TomlParser() : cur_line_(0) {
+void TomlParser::reset(const char *data, size_t size) {
+   begin_ = pos_ = data;
+   end_ = data + size;
+   errors_.clear();
+   error_text_.clear();
+   depth_ = num_keys_ = 0;
+   stopped_ = hit_max_errors_ = false;
 
+   // Lines are counted as we move onto each newline, so count a leading one here
+   cur_line_ = (cur() == '\n') ? 1 : 0;
 }
 
-TomlParser::TomlParser(std::string filename) : cur_line_(0) {
-   this->open(filename);
+TomlParser::Position TomlParser::position_of(const char *at) const {
+   // Keys replayed from another document don't point into the source
+   if (!at || at < begin_ || at > end_) at = pos_;
+
+   const char *line_start = at;
+   while (line_start > begin_ && line_start[-1] != '\n') --line_start;
+
+   Position position = { line_of(at), static_cast<int>(at - line_start), static_cast<size_t>(at - begin_) };
+   return position;
 }
 
-void TomlParser::error(const char *format, ...) {
-   char buffer[1024];
+void TomlParser::add_error(TomlErrorCode code, int line, const char *at, char c,
+   const char *text, size_t text_size, const char *detail, size_t detail_size) {
+   if (stopped_) return;
 
-   va_list args; va_start(args, format);
-   vsnprintf(buffer, 1024, format, args);
-   va_end(args);
+   Position position = position_of(at);
+   position.line = line;
+   add_error(code, position, c, text, text_size, detail, detail_size);
+}
 
-   errors_.push_back(TomlError(buffer, cur_line_));
+void TomlParser::add_error(TomlErrorCode code, const Position &position, char c,
+   const char *text, size_t text_size, const char *detail, size_t detail_size) {
+   if (stopped_) return;
 
-   // Now we skip to the next line
-   while (next_char() != '\n' && cur()) { }
-   next_char();
+   ErrorRecord record;
+   record.code = code;
+   record.line = position.line;
+   record.column = position.column;
+   record.offset = position.offset;
+   record.c = c;
+
+   record.text = error_text_.size();
+   record.text_size = std::min(text_size, kMaxErrorText);
+   error_text_.append(text, record.text_size);
+
+   record.detail = error_text_.size();
+   record.detail_size = std::min(detail_size, kMaxErrorText);
+   error_text_.append(detail, record.detail_size);
+
+   errors_.push_back(record);
+
+   // Give up on the rest of the source, noting whether that cut anything short
+   if (max_errors_ && errors_.size() >= max_errors_) {
+      const char *at = position.offset <= static_cast<size_t>(end_ - begin_) ? begin_ + position.offset : pos_;
+      hit_max_errors_ = more_entries(at, end_);
+      stop();
+   }
 }
 
-bool TomlParser::is_whitespace(char c, bool new_line) {
-   if (!new_line && (c == '\n' || c == '\r')) return false;
-   return isspace(c);
+void TomlParser::stop() {
+   stopped_ = true;
+   pos_ = end_;
 }
 
-bool TomlParser::is_numeric(char c) {
-   return isdigit(c);
+void TomlParser::limit_error(int line, const char *at, const char *name, size_t limit) {
+   std::string value = std::to_string(limit);
+   add_error(TomlErrorCode::LimitExceeded, line, at, '\0', name, strlen(name), value.data(), value.size());
+   stop();
 }
 
-bool TomlParser::is_integer(std::string str) {
-   // An integer must have only numeric digits. It may start with with a '-'.
-   if (str == "") return false;
-   if (!is_numeric(str[0]) && str[0] != '-') return false;
+bool TomlParser::check_size() {
+   if (!limits_.max_bytes || static_cast<size_t>(end_ - begin_) <= limits_.max_bytes) return true;
 
-   for (auto ch : str.substr(1)) {
-      if (!is_numeric(ch)) return false;
-   }
+   limit_error(0, begin_, "max_bytes", limits_.max_bytes);
+   return false;
+}
 
-   return true;
+void TomlParser::error(TomlErrorCode code, char c) {
+   add_error(code, cur_line_, pos_, c, nullptr, 0, nullptr, 0);
+
+   // Now we skip to the next line
+   skip_line();
 }
 
-bool TomlParser::is_float(std::string str) {
-   // A decimal may have a decimal point and a sign.
-   if (str == "") return false;
-   if (!is_numeric(str[0]) && str[0] != '-') return false;
+void TomlParser::error(TomlErrorCode code, const char *at, const char *text, size_t text_size) {
+   add_error(code, cur_line_, at, '\0', text, text_size, nullptr, 0);
+   skip_line();
+}
+
+void TomlParser::error_at(TomlErrorCode code, int line, const char *at, const std::string &text,
+   const std::string &detail) {
+   add_error(code, line, at, '\0', text.data(), text.size(), detail.data(), detail.size());
+}
 
-   bool decimal = false;
-   for (auto ch : str.substr(1)) {
-      if (ch == '.') {
-         if (decimal) return false; // Double decimal point
-         decimal = true;
-      } else if(!is_numeric(ch)) return false;
+void TomlParser::error_at(TomlErrorCode code, const Position &position, const std::string &text) {
+   add_error(code, position, '\0', text.data(), text.size(), nullptr, 0);
+}
+
+TomlError TomlParser::get_error(int i) const {
+   const ErrorRecord &record = errors_[i];
+   std::string text = error_text_.substr(record.text, record.text_size);
+
+   std::string message;
+   switch (record.code) {
+      case TomlErrorCode::ExpectedChar: message = std::string("Expected '") + record.c + "'"; break;
+      case TomlErrorCode::InvalidEscape: message = std::string("Invalid escape character \\") + record.c; break;
+      case TomlErrorCode::InvalidValue: message = "\"" + text + "\" is not a valid value"; break;
+      case TomlErrorCode::OutOfRange: message = "\"" + text + "\" is out of range"; break;
+      case TomlErrorCode::DuplicateKey: message = "The key '" + text + "' has already been used"; break;
+      case TomlErrorCode::TypeMismatch:
+         message = "Key '" + text + "' should be " + error_text_.substr(record.detail, record.detail_size);
+         break;
+      case TomlErrorCode::MissingKey: message = "Missing key '" + text + "'"; break;
+      case TomlErrorCode::LimitExceeded:
+         message = "The document exceeds " + text + " of " + error_text_.substr(record.detail, record.detail_size);
+         break;
    }
 
-   return true;
+   return TomlError(record.code, message, record.line, record.offset, record.column);
 }
 
-bool TomlParser::is_datetime(std::string str) {
-   // A datetime has the format YYYY-MM-DDThh:mm:ssZ
-   // GCC still has an incomplete support for regex,
-   // so it is not used here
-   if (str.length() != 20) return false;
-   return str[4] == '-' && str[7] == '-' && str[10] == 'T' &&
-      str[13] == ':' && str[16] == ':' && str[19] == 'Z';
+void TomlParser::skip_line() {
+   if (pos_ < end_) jump_to(toml_find_newline(pos_ + 1, end_));
+   next_char();
 }
 
-tm TomlParser::to_time(std::string str) {
-   int year, mon, mday, hour, min, sec;
-   sscanf(str.c_str(), "%d-%d-%dT%d:%d:%dZ", &year, &mon, &mday, &hour, &min, &sec);
+bool TomlParser::is_whitespace(char c, bool new_line) {
+   if (!new_line && (c == '\n' || c == '\r')) return false;
+   return toml_is_space(c);
+}
 
-   tm date;
-   date.tm_year = year - 1900;
-   date.tm_mon = mon - 1;
-   date.tm_mday = mday;
-   date.tm_hour = hour + 1;
-   date.tm_min = min;
-   date.tm_sec = sec;
+bool TomlParser::is_numeric(char c) {
+   return toml_is_digit(c);
+}
 
-   return date;
+bool TomlParser::Token::equals(const char *str) const {
+   size_t len = strlen(str);
+   return size() == len && memcmp(begin, str, len) == 0;
 }
 
 char TomlParser::next_char() {
-   char ch = source_file_.get();
-   *cur_ = (ch == EOF ? '\0' : ch);
+   if (pos_ < end_) ++pos_;
 
    if (cur() == '\n') cur_line_++;
    return cur();
 }
 
+int TomlParser::line_of(const char *at) const {
+   // Keys replayed from another document don't point into the source
+   if (at < begin_ || at > end_) return cur_line_;
+
+   // cur_line_ counts the newlines up to and including the current character
+   if (at <= pos_) return cur_line_ - toml_count_newlines(at, pos_ < end_ ? pos_ + 1 : end_);
+   return toml_count_newlines(begin_, at);
+}
+
+void TomlParser::jump_to(const char *p) {
+   if (p > pos_) {
+      // Count the newlines moved onto, as next_char() would
+      cur_line_ += toml_count_newlines(pos_ + 1, p < end_ ? p + 1 : end_);
+      pos_ = p;
+   }
+}
+
 char TomlParser::next_skip_whitespace(bool new_lines) {
    while(next_char() && is_whitespace(cur(), new_lines)) { }
    return cur();
 }
 
 void TomlParser::expect(char c) {
-   if (cur() != c) error("Expected '%c'", c);
+   if (cur() != c) error(TomlErrorCode::ExpectedChar, c);
    next_char();
 }
 
@@ -197,93 +470,170 @@ void TomlParser::advance(char c, bool new_line) {
 }
 
 void TomlParser::skip_whitespace(bool new_line) {
-   if (is_whitespace(cur(), new_line)) next_skip_whitespace(new_line);
+   if (new_line) {
+      jump_to(toml_skip_spaces(pos_, end_));
+   } else if (is_whitespace(cur(), new_line)) {
+      next_skip_whitespace(new_line);
+   }
 }
 
 void TomlParser::skip_whitespace_and_comments() {
-   while (cur() && (is_whitespace(cur(), true) || cur() == '#')) {
-      if (cur() == '#') {
-         while (cur() && cur() != '\n') next_char();
-      }
-      next_char();
+   for (;;) {
+      const char *p = toml_skip_spaces(pos_, end_);
+      if (p < end_ && *p == '#') p = toml_find_newline(p, end_);
+
+      if (p == pos_) break;
+      jump_to(p);
    }
 }
 
-std::shared_ptr<TomlValue> TomlParser::parse_string() {
-   // A string is a double quoted string literal
-   std::string str;
+void TomlParser::parse_string(TomlHandler &handler) {
+   CTOML_STATS(stats_.strings++; TomlStatsTimer timer(stats_.string_ns));
 
+   // A string is a double quoted string literal
    expect('"');
-   while (cur()) {
-      char c = cur(); next_char();
+
+   // Most strings have no escapes, so they can be copied straight out of the source
+   Token run = { pos_, toml_find_quote_or_escape(pos_, end_) };
+   if (limits_.max_string_length && run.size() > limits_.max_string_length) {
+      return limit_error(cur_line_, run.begin, "max_string_length", limits_.max_string_length);
+   }
+   jump_to(run.end);
+
+   if (cur() != '\\') {
+      next_char(); // Closing quote
+      CTOML_STATS(timer.stop());
+      handler.on_string(run.begin, run.size());
+      return;
+   }
+
+   // Otherwise unescape into the scratch buffer, a run at a time
+   scratch_.assign(run.begin, run.end);
+   while (cur() == '\\') {
+      char c = next_char();
 
       // Handle special characters
-      if (c == '\\' && cur()) {
-         // TODO(evilncrazy): support null characters
-         if (cur() == 't') c = '\t';
-         else if (cur() == 'n') c = '\n';
-         else if (cur() == 'r') c = '\r';
-         else if (cur() == '"') c = '"';
-         else if (cur() == '\\') c = '\\';
+      // TODO(evilncrazy): support null characters
+      if (!c) {
+         scratch_ += '\\';
+         break;
+      }
+      else if (c == 'u' || c == 'U') {
+         int digits = c == 'u' ? 4 : 8;
+         std::uint32_t code;
+         if (!read_unicode_escape(pos_ + 1, end_, digits, &code)) {
+            error(TomlErrorCode::InvalidEscape, c);
+            return;
+         }
+
+         append_utf8(scratch_, code);
+         jump_to(pos_ + digits);
+      }
+      else {
+         if (c == 't') c = '\t';
+         else if (c == 'n') c = '\n';
+         else if (c == 'r') c = '\r';
+         else if (c == 'b') c = '\b';
+         else if (c == 'f') c = '\f';
+         else if (c == '"') c = '"';
+         else if (c == '\\') c = '\\';
          else {
-            error("Invalid escape character \\%c", cur());
-            return nullptr;
+            error(TomlErrorCode::InvalidEscape, c);
+            return;
          }
 
-         next_char();
-      } else if (c == '"') {
-         // String closed in a double quote
-         break;
+         scratch_ += c;
       }
+      next_char();
 
-      str += c;
+      const char *run_end = toml_find_quote_or_escape(pos_, end_);
+      if (limits_.max_string_length && scratch_.size() + (run_end - pos_) > limits_.max_string_length) {
+         return limit_error(cur_line_, run.begin, "max_string_length", limits_.max_string_length);
+      }
+      scratch_.append(pos_, run_end);
+      jump_to(run_end);
    }
 
-   return TomlValue::create_string(str);
+   next_char(); // Closing quote
+   CTOML_STATS(timer.stop());
+   handler.on_string(scratch_.data(), scratch_.size());
 }
 
-std::shared_ptr<TomlValue> TomlParser::parse_number() {
-   std::string number;
+void TomlParser::parse_number(TomlHandler &handler) {
+   Token number = { pos_, pos_ };
    while (cur() && !is_whitespace(cur(), true) && cur() != ',' && cur() != ']') {
-      number += cur();
       next_char();
    }
+   number.end = pos_;
 
    // Decide what data type it is
-#ifdef _WIN32
-   if (is_integer(number))  return TomlValue::create_int(_atoi64(number.c_str()));
-#else
-   if (is_integer(number))  return TomlValue::create_int(atoll(number.c_str()));
-#endif
-   if (is_float(number)) return TomlValue::create_float(atof(number.c_str()));
-   if (is_datetime(number)) return TomlValue::create_datetime(to_time(number));
-   
-   error("\"%s\" is not a valid value", number.c_str());
-   return nullptr;
+   std::int64_t int_value;
+   TomlNumberResult result = toml_parse_int(number.begin, number.end, &int_value);
+   if (result == TomlNumberResult::Ok) {
+      CTOML_STATS(stats_.ints++);
+      return handler.on_int(int_value);
+   }
+
+   double float_value;
+   if (result == TomlNumberResult::Invalid) {
+      result = toml_parse_float(number.begin, number.end, &float_value);
+      if (result == TomlNumberResult::Ok) {
+         CTOML_STATS(stats_.floats++);
+         return handler.on_float(float_value);
+      }
+   }
+
+   if (result == TomlNumberResult::OutOfRange) {
+      error(TomlErrorCode::OutOfRange, number.begin, number.begin, number.size());
+      return;
+   }
+
+   time_t time_value;
+   if (toml_parse_datetime(number.begin, number.end, &time_value)) {
+      CTOML_STATS(stats_.datetimes++);
+      return handler.on_datetime(time_value);
+   }
+
+   error(TomlErrorCode::InvalidValue, number.begin, number.begin, number.size());
 }
 
-std::shared_ptr<TomlValue> TomlParser::parse_boolean() {
-   std::string str;
-   while (cur() && !is_whitespace(cur(), true)) {
-      str += cur();
+void TomlParser::parse_boolean(TomlHandler &handler) {
+   // Like a number, a boolean ends at whitespace or at the end of an array element
+   Token str = { pos_, pos_ };
+   while (cur() && !is_whitespace(cur(), true) && cur() != ',' && cur() != ']') {
       next_char();
    }
+   str.end = pos_;
 
-   if (str == "true") return TomlValue::create_boolean(true);
-   else if(str == "false") return TomlValue::create_boolean(false);
-   else {
-      error("\"%s\" is not a valid value", str.c_str());
-      return nullptr;
+   bool is_true = str.equals("true");
+   if (!is_true && !str.equals("false")) {
+      error(TomlErrorCode::InvalidValue, str.begin, str.begin, str.size());
+      return;
    }
+
+   CTOML_STATS(stats_.booleans++);
+   handler.on_boolean(is_true);
 }
 
-std::shared_ptr<TomlValue> TomlParser::parse_array() {
+void TomlParser::parse_array(TomlHandler &handler) {
+   if (limits_.max_depth && depth_ >= limits_.max_depth) {
+      return limit_error(cur_line_, pos_, "max_depth", limits_.max_depth);
+   }
    expect('[');
 
-   auto array = std::static_pointer_cast<TomlArray>(std::shared_ptr<TomlValue>(TomlValue::create_array()));
+   CTOML_STATS(stats_.arrays++);
+   depth_++;
+   handler.on_array_begin();
+
+   size_t length = 0;
    while (cur() && cur() != ']') {
+      if (limits_.max_array_length && ++length > limits_.max_array_length) {
+         limit_error(cur_line_, pos_, "max_array_length", limits_.max_array_length);
+         break;
+      }
+
       skip_whitespace_and_comments();
-      array->add(parse_value());
+      parse_value(handler);
 
       skip_whitespace_and_comments();
       if (cur() == ']') break;
@@ -292,91 +642,792 @@ std::shared_ptr<TomlValue> TomlParser::parse_array() {
    }
 
    advance(']');
-   return array;
+   depth_--;
+   handler.on_array_end();
 }
 
-std::string TomlParser::parse_key_group() {
+TomlParser::Token TomlParser::parse_key_group() {
    expect('[');
 
    // Read until close bracket
-   std::string key;
+   Token key = { pos_, pos_ };
    while (cur() && cur() != ']') {
-      key += cur();
       next_char();
    }
+   key.end = pos_;
 
    expect(']');
    return key;
 }
 
-std::shared_ptr<TomlValue> TomlParser::parse_value() {
-   if (cur() == '"') return parse_string();
-   if (is_numeric(cur()) || cur() == '-') return parse_number();
-   if (cur() == '[') return parse_array();
-   return parse_boolean();
+void TomlParser::parse_value(TomlHandler &handler) {
+   if (cur() == '"') return parse_string(handler);
+   if (is_numeric(cur()) || cur() == '-') return parse_number(handler);
+   if (cur() == '[') return parse_array(handler);
+   return parse_boolean(handler);
 }
 
-std::string TomlParser::parse_key() {
-   std::string key;
+TomlParser::Token TomlParser::parse_key() {
+   Token key = { pos_, pos_ };
    while (cur() && !is_whitespace(cur()) && cur() != '=') {
-      key += cur();
       next_char();
    }
+   key.end = pos_;
 
    return key;
 }
 
-TomlDocument TomlParser::parse() {
-   if (!good()) {
-      // Return empty document error in file
-      return TomlDocument();
+TomlParser::GroupState::GroupState(TomlDocument &doc) : table(&doc.root_), conflict(0) { }
+
+void TomlParser::enter_group(TomlDocument &doc, GroupState &group, Token name) {
+   CTOML_STATS(TomlStatsTimer timer(stats_.insert_ns));
+
+   group.name.assign(name.begin, name.end);
+   group.name += '.';
+
+   group.table = doc.make_tables(&doc.root_, name.begin, name.size(), &group.conflict);
+}
+
+void TomlParser::insert_value(TomlDocument &doc, GroupState &group, Token local_key,
+   std::shared_ptr<TomlValue> value) {
+   CTOML_STATS(TomlStatsTimer timer(stats_.insert_ns));
+
+   std::string &key = group.key;
+   key.assign(group.name);
+   key.append(local_key.begin, local_key.end);
+
+   // We check all the prefix key groups to ensure that they haven't
+   // already been defined previously
+   TomlTable *table = group.table;
+   size_t conflict = group.conflict;
+   const char *name = local_key.begin;
+
+   const char *dot = nullptr;
+   for (const char *c = local_key.begin; c != local_key.end; ++c) {
+      if (*c == '.') dot = c;
+   }
+   if (table && dot) {
+      // The key itself is dotted
+      table = doc.make_tables(table, local_key.begin, dot - local_key.begin, &conflict);
+      conflict += group.name.size();
+      name = dot + 1;
    }
 
-   // The final document
-   TomlDocument doc;
+   if (!table) {
+      error_at(TomlErrorCode::DuplicateKey, line_of(local_key.begin), local_key.begin, key.substr(0, conflict));
+   } else if (table->find(name, local_key.end - name)) {
+      // Now check the whole key
+      error_at(TomlErrorCode::DuplicateKey, line_of(local_key.begin), local_key.begin, key);
+   } else if (success()) {
+      doc.add_value(table, name, local_key.end - name, key, value);
+   }
+}
 
-   std::string cur_group;
+void TomlParser::parse_entries(TomlHandler &handler) {
+   CTOML_STATS(const char *start = pos_);
 
    // Find next non-whitespace character
    while (skip_whitespace_and_comments(), cur()) {
       if(cur() == '[') {
          // Key group (it's not an array as an array is always a value)
-         cur_group = parse_key_group() + ".";
+         Token name = parse_key_group();
+         CTOML_STATS(stats_.tables++);
+         handler.on_table_header(name.begin, name.size());
       } else {
-         std::string key = cur_group + parse_key();
+         Token local_key = parse_key();
          advance('='); skip_whitespace();
 
-         std::shared_ptr<TomlValue> value = parse_value();
-         if (value) {
-            // We check all the prefix key groups to ensure that they haven't
-            // already been defined previously
-            size_t dot_pos = 0;
-            while (dot_pos = key.find(".", dot_pos + 1), dot_pos != std::string::npos) {
-               std::string key_group(key, 0, dot_pos);
-               if(doc.is_key(key_group)) {
-                  error("The key '%s' has already been used", key_group.c_str());
-                  break;
-               }
+         if (limits_.max_keys && ++num_keys_ > limits_.max_keys) {
+            limit_error(cur_line_, local_key.begin, "max_keys", limits_.max_keys);
+            break;
+         }
+
+         CTOML_STATS(stats_.keys++);
+         handler.on_key(local_key.begin, local_key.size());
+         parse_value(handler);
+      }
+   }
+
+   CTOML_STATS(stats_.bytes_scanned += pos_ - start);
+}
+
+// Builds values from parse events. They are inserted into a document, or when
+// a section is parsed on a worker thread, collected to be inserted later.
+class TomlParser::Builder : public TomlHandler {
+   TomlParser &parser_;
+   TomlDocument *doc_;
+   std::vector<PendingEntry> *pending_;
+
+   // The current key group. Its table is resolved once per group header, so
+   // inserting a key only has to look at the key itself.
+   std::unique_ptr<GroupState> group_;
+
+   // The key of the value being parsed, and the arrays it is nested in
+   Token key_;
+   std::vector<std::shared_ptr<TomlValue>> arrays_;
+
+   // Create a value, counting it (and extra_bytes of contents) in the parser's stats
+   template <class T, class... Args>
+   std::shared_ptr<TomlValue> make(size_t extra_bytes, Args&&... args) {
+      CTOML_STATS(
+         TomlParseStats &stats = parser_.stats_;
+         stats.allocations++;
+         stats.bytes_allocated += sizeof(T) + extra_bytes;
+         TomlStatsTimer timer(stats.value_ns));
+      (void)extra_bytes;
+
+      return parser_.make_value<T>(std::forward<Args>(args)...);
+   }
+
+   void add(std::shared_ptr<TomlValue> value) {
+      if (!arrays_.empty()) {
+         static_cast<TomlArray &>(*arrays_.back()).add(value);
+      } else if (pending_) {
+         PendingEntry entry = { key_, value };
+         pending_->push_back(entry);
+      } else {
+         size_t num_errors = parser_.errors_.size();
+         parser_.insert_value(*doc_, *group_, key_, value);
+
+         // Skip the rest of the value's line, unless it has already ended
+         if (parser_.errors_.size() != num_errors && parser_.cur() != '\n') parser_.skip_line();
+      }
+   }
+public:
+   Builder(TomlParser &parser, TomlDocument *doc, std::vector<PendingEntry> *pending) :
+      parser_(parser), doc_(doc), pending_(pending) {
+      if (doc_) group_.reset(new GroupState(*doc_));
+      key_.begin = key_.end = nullptr;
+   }
+
+   void on_table_header(const char *name, size_t len) {
+      Token token = { name, name + len };
+      if (pending_) {
+         PendingEntry entry = { token, nullptr };
+         pending_->push_back(entry);
+      } else {
+         parser_.enter_group(*doc_, *group_, token);
+      }
+   }
+
+   void on_key(const char *key, size_t len) {
+      key_.begin = key;
+      key_.end = key + len;
+      arrays_.clear();
+   }
+
+   // Add a key and value from another document, parsed from the same text
+   void on_previous_entry(const TomlDocument::value_type &entry) {
+      size_t group_size = group_->name.size();
+      on_key(entry.first.data() + group_size, entry.first.size() - group_size);
+      add(entry.second);
+   }
+
+   void on_string(const char *str, size_t len) {
+      add(make<TomlString>(len, str, len, parser_.value_resource()));
+   }
+
+   // Array elements of these types are stored unboxed, so don't make values for them
+   void on_int(std::int64_t value) {
+      if (!arrays_.empty()) {
+         CTOML_STATS(parser_.stats_.bytes_allocated += sizeof(std::int64_t));
+         static_cast<TomlArray &>(*arrays_.back()).add_int(value);
+      } else {
+         add(make<TomlInt>(0, value));
+      }
+   }
+
+   void on_float(double value) {
+      if (!arrays_.empty()) {
+         CTOML_STATS(parser_.stats_.bytes_allocated += sizeof(double));
+         static_cast<TomlArray &>(*arrays_.back()).add_float(value);
+      } else {
+         add(make<TomlFloat>(0, value));
+      }
+   }
+
+   void on_boolean(bool value) {
+      if (!arrays_.empty()) {
+         CTOML_STATS(parser_.stats_.bytes_allocated += sizeof(std::uint8_t));
+         static_cast<TomlArray &>(*arrays_.back()).add_boolean(value);
+      } else {
+         add(make<TomlBoolean>(0, value));
+      }
+   }
+   void on_datetime(time_t value) { add(make<TomlDateTime>(0, value)); }
+
+   void on_array_begin() {
+      arrays_.push_back(make<TomlArray>(0, parser_.value_resource()));
+   }
+
+   void on_array_end() {
+      std::shared_ptr<TomlValue> array = arrays_.back();
+      arrays_.pop_back();
+      add(array);
+   }
+};
+
+void TomlParser::skip_string() {
+   expect('"');
+
+   const char *begin = pos_;
+   size_t escaped_bytes = 0;
+   for (;;) {
+      jump_to(toml_find_quote_or_escape(pos_, end_));
+      if (cur() != '\\') break;
+
+      // Skip the escaped character too, and a unicode escape's digits
+      char c = next_char();
+      next_char();
+
+      int digits = c == 'u' ? 4 : c == 'U' ? 8 : 0;
+      std::uint32_t code;
+      if (digits && read_unicode_escape(pos_, end_, digits, &code)) {
+         jump_to(pos_ + digits);
+         escaped_bytes += 2 + digits - utf8_length(code);
+      }
+      else escaped_bytes++;
+   }
+
+   // Escape sequences unescape to fewer bytes than they take in the source
+   if (limits_.max_string_length && static_cast<size_t>(pos_ - begin) - escaped_bytes > limits_.max_string_length) {
+      return limit_error(cur_line_, begin, "max_string_length", limits_.max_string_length);
+   }
+
+   next_char(); // Closing quote
+}
+
+TomlParser::Token TomlParser::skip_value() {
+   Token value = { pos_, pos_ };
+
+   if (cur() == '"') {
+      skip_string();
+   } else if (cur() == '[') {
+      // Find the matching bracket, stepping over strings and comments
+      int depth = 0;
+      do {
+         if (cur() == '"') {
+            skip_string();
+            continue;
+         }
+
+         if (cur() == '#') {
+            jump_to(toml_find_newline(pos_, end_));
+            continue;
+         }
+
+         if (cur() == '[') {
+            if (limits_.max_depth && static_cast<size_t>(depth) >= limits_.max_depth) {
+               limit_error(cur_line_, pos_, "max_depth", limits_.max_depth);
+               break;
             }
+            depth++;
+         } else if (cur() == ']') {
+            depth--;
+         }
+         jump_to(toml_find_structural(pos_ + 1, end_));
+      } while (depth > 0 && cur());
+   } else {
+      // Numbers, booleans and datetimes
+      while (cur() && !is_whitespace(cur(), true) && cur() != ',' && cur() != ']') next_char();
+   }
+
+   value.end = pos_;
+   return value;
+}
+
+void TomlParser::index_entries(TomlLazyDocument &doc) {
+   TomlDocument &index = doc.index_;
+   GroupState group(index);
+   CTOML_STATS(const char *start = pos_);
+
+   while (skip_whitespace_and_comments(), cur()) {
+      if(cur() == '[') {
+         CTOML_STATS(stats_.tables++);
+         enter_group(index, group, parse_key_group());
+         continue;
+      }
+
+      Token local_key = parse_key();
+      advance('='); skip_whitespace();
+
+      if (limits_.max_keys && ++num_keys_ > limits_.max_keys) {
+         limit_error(cur_line_, local_key.begin, "max_keys", limits_.max_keys);
+         break;
+      }
+      CTOML_STATS(stats_.keys++);
+
+      int line = cur_line_;
+      Token value = skip_value();
+      if (value.size() == 0) {
+         error(TomlErrorCode::InvalidValue, value.begin, nullptr, 0);
+         continue;
+      }
+
+      size_t num_errors = errors_.size();
+      insert_value(index, group, local_key, nullptr);
+
+      if (errors_.size() != num_errors) {
+         if (cur() != '\n') skip_line();
+      } else if (index.size() > doc.spans_.size()) {
+         TomlLazyDocument::Span span = { value.begin, value.end, line };
+         doc.spans_.push_back(span);
+      }
+   }
+
+   CTOML_STATS(stats_.bytes_scanned += pos_ - start);
+}
+
+void TomlParser::replay_section(Builder &builder, const TomlDocument &previous,
+   const TomlDocument::Section &section) {
+   skip_whitespace_and_comments();
+   if (cur() == '[') {
+      Token name = parse_key_group();
+      builder.on_table_header(name.begin, name.size());
+   }
+
+   for (size_t i = 0; i < section.num_slots; i++) {
+      builder.on_previous_entry(previous.values_[section.first_slot + i]);
+   }
+   num_keys_ += section.num_slots;
+
+   jump_to(end_);
+}
+
+bool TomlParser::replay_fits(const TomlDocument &previous, const TomlDocument::Section &section) const {
+   if (limits_.max_keys && num_keys_ + section.num_slots > limits_.max_keys) return false;
+
+   for (size_t i = 0; i < section.num_slots; i++) {
+      if (!value_fits(*previous.values_[section.first_slot + i].second, 0)) return false;
+   }
+
+   return true;
+}
+
+bool TomlParser::value_fits(const TomlValue &value, size_t depth) const {
+   if (value.type() == TomlType::String) {
+      return !limits_.max_string_length || static_cast<const TomlString &>(value).size() <= limits_.max_string_length;
+   }
+   if (value.type() != TomlType::Array) return true;
+
+   const TomlArray &array = static_cast<const TomlArray &>(value);
+   if (limits_.max_depth && depth >= limits_.max_depth) return false;
+   if (limits_.max_array_length && array.size() > limits_.max_array_length) return false;
+
+   // Unboxed arrays hold no strings or arrays
+   if (array.int_span().size() || array.float_span().size() || array.bool_span().size()) return true;
 
-            // Now check the whole key
-            if (!doc.is_key(key)) {
-               if (success())
-                  doc.insert(key, value);
-            } else {
-               error("The key '%s' has already been used", key.c_str());
+   for (size_t i = 0; i < array.size(); i++) {
+      if (!value_fits(*array.at(static_cast<int>(i)), depth + 1)) return false;
+   }
+
+   return true;
+}
+
+std::shared_ptr<TomlValue> TomlParser::decode_value(const char *begin, const char *end, int line,
+   TomlMemoryResource *resource) {
+   TomlParser parser;
+   parser.reset(begin, end - begin);
+   parser.cur_line_ = line;
+   parser.resource_ = resource;
+
+   std::vector<PendingEntry> values;
+   Builder builder(parser, nullptr, &values);
+   parser.parse_value(builder);
+
+   if (!parser.success() || values.size() != 1) return nullptr;
+   return values[0].value;
+}
+
+// Splits a document into sections that each start with a top-level key group
+// header, so they can be parsed independently. Returns false if the document
+// looks malformed, in which case it should just be parsed serially.
+static bool find_sections(const char *begin, const char *end, std::vector<const char *> &sections,
+   std::vector<int> &lines) {
+   sections.assign(1, begin);
+   lines.assign(1, (begin != end && *begin == '\n') ? 1 : 0);
+
+   int line = 0, depth = 0;
+   const char *line_start = begin;
+   bool at_line_start = true, in_value = false;
+
+   for (const char *p = begin; p < end; ++p) {
+      char c = *p;
+
+      if (c == '\n') {
+         line++;
+         line_start = p + 1;
+         if (depth == 0) {
+            at_line_start = true;
+            in_value = false;
+         }
+         continue;
+      }
+
+      if (at_line_start) {
+         if (c == ' ' || c == '\t' || c == '\r') continue;
+         at_line_start = false;
+
+         if (c == '[') {
+            // A key group header. Its name runs up to the first ']'.
+            if (line_start != begin) {
+               sections.push_back(line_start);
+               lines.push_back(line);
             }
+
+            while (p < end && *p != ']' && *p != '\n') ++p;
+            if (p == end || *p != ']') return false;
+
+            // Only a comment may follow
+            in_value = true;
+            continue;
+         }
+
+         if (c == '#') {
+            in_value = true;
+         }
+      }
+
+      if (!in_value) {
+         // Keys run up to the '='
+         if (c == '=') in_value = true;
+      } else if (c == '#') {
+         // Comment
+         p = toml_find_newline(p, end) - 1;
+         continue;
+      } else if (c == '"') {
+         // String, which may contain escaped quotes
+         const char *q = p + 1;
+         while ((q = toml_find_quote_or_escape(q, end)) < end && *q == '\\') q += 2;
+         if (q >= end) return false;
+
+         line += toml_count_newlines(p, q);
+         p = q;
+      } else if (c == '[') {
+         depth++;
+      } else if (c == ']') {
+         if (--depth < 0) return false;
+      }
+
+      // Skip ahead to the next character that could matter
+      p = toml_find_structural(p + 1, end) - 1;
+   }
+
+   return depth == 0;
+}
+
+void TomlParser::parse_sections(TomlDocument &doc, const std::vector<const char *> &sections,
+   const std::vector<int> &lines, unsigned num_threads) {
+   // Group the sections into a few chunks per thread, of roughly equal size
+   struct Chunk {
+      const char *begin;
+      const char *end;
+      int line;
+
+      std::vector<PendingEntry> entries;
+      bool failed;
+      std::shared_ptr<TomlArena> arena;
+      TomlParseStats stats;
+   };
+
+   std::vector<Chunk> chunks;
+   size_t target = (end_ - begin_) / (num_threads * 4) + 1;
+   for (size_t i = 0; i < sections.size(); i++) {
+      const char *section_end = i + 1 < sections.size() ? sections[i + 1] : end_;
+
+      if (chunks.empty() || static_cast<size_t>(chunks.back().end - chunks.back().begin) >= target) {
+         Chunk chunk;
+         chunk.begin = chunk.end = sections[i];
+         chunk.line = lines[i];
+         chunk.failed = false;
+         chunks.push_back(chunk);
+      }
+
+      chunks.back().end = section_end;
+   }
+
+   // Parse the chunks in parallel. Each worker only lexes and builds values;
+   // keys are inserted (and checked for duplicates) in order afterwards.
+   toml_parallel_for(chunks.size(), num_threads, [&](size_t i) {
+      Chunk &chunk = chunks[i];
+
+      TomlParser worker;
+      worker.copy_settings(*this);
+      worker.reset(chunk.begin, chunk.end - chunk.begin);
+
+      // Any error means parsing again serially, so stop at the first
+      worker.max_errors_ = 1;
+      worker.cur_line_ = chunk.line;
+      worker.arena_ = make_arena();
+
+      Builder builder(worker, nullptr, &chunk.entries);
+      worker.parse_entries(builder);
+
+      chunk.failed = !worker.success();
+      chunk.arena = worker.arena_;
+      chunk.stats = worker.stats_;
+   });
+
+   // On any error, parse again serially, so that error recovery (and
+   // therefore every diagnostic after the first) is exactly that of parse()
+   auto parse_serially = [&] {
+      reset(begin_, end_ - begin_);
+      doc = TomlDocument(arena_ = make_arena());
+
+      Builder builder(*this, &doc, nullptr);
+      parse_entries(builder);
+   };
+
+   for (auto &chunk : chunks) {
+      if (chunk.failed) return parse_serially();
+   }
+
+   // Merge the chunks into the document. Each chunk was checked against the
+   // limits on its own, but the number of keys can only be checked here.
+   GroupState group(doc);
+   for (auto &chunk : chunks) {
+      if (arena_ && chunk.arena) arena_->attach(chunk.arena);
+
+      for (auto &entry : chunk.entries) {
+         if (!entry.value) {
+            enter_group(doc, group, entry.key);
+            continue;
+         }
+
+         if (limits_.max_keys && ++num_keys_ > limits_.max_keys) {
+            return limit_error(line_of(entry.key.begin), entry.key.begin, "max_keys", limits_.max_keys);
          }
+
+         insert_value(doc, group, entry.key, entry.value);
+         if (!errors_.empty()) return parse_serially();
       }
    }
 
+   for (auto &chunk : chunks) stats_ += chunk.stats;
+}
+
+TomlDocument TomlParser::parse() {
+   if (!good()) {
+      // Return empty document error in file
+      return TomlDocument();
+   }
+
+   if (!check_size()) {
+      this->close();
+      return TomlDocument();
+   }
+
+   CTOML_STATS(TomlStatsTimer timer(stats_.parse_ns));
+
+   // The final document
+   arena_ = make_arena();
+   TomlDocument doc(arena_);
+
+   unsigned num_threads = num_threads_ ? num_threads_ : toml_default_threads();
+
+   std::vector<const char *> sections;
+   std::vector<int> lines;
+   if (num_threads > 1 && static_cast<size_t>(end_ - begin_) >= kMinParallelSize &&
+      find_sections(begin_, end_, sections, lines) && sections.size() > 1) {
+      parse_sections(doc, sections, lines, num_threads);
+   } else {
+      Builder builder(*this, &doc, nullptr);
+      parse_entries(builder);
+   }
+
+   this->close();
+   arena_ = nullptr;
+
+   return doc;
+}
+
+TomlDocument TomlParser::parse_buffer(const char *data, size_t size) {
+   close();
+   reset(data, size);
+   stats_.clear();
+
+   return parse();
+}
+
+TomlDocument TomlParser::parse_buffer(const std::string &source) {
+   return parse_buffer(source.data(), source.size());
+}
+
+TomlLazyDocument TomlParser::parse_lazy() {
+   TomlLazyDocument doc;
+   if (!good()) return doc;
+
+   if (!check_size()) {
+      this->close();
+      return doc;
+   }
+
+   CTOML_STATS(TomlStatsTimer timer(stats_.parse_ns));
+   index_entries(doc);
+   doc.file_ = source_file_;
+   doc.resource_ = resource_;
+
    this->close();
+   return doc;
+}
+
+TomlLazyDocument TomlParser::parse_buffer_lazy(const char *data, size_t size) {
+   close();
+   reset(data, size);
+   stats_.clear();
+
+   return parse_lazy();
+}
+
+TomlDocument TomlParser::reparse(const TomlDocument &previous, TomlDiff &diff) {
+   TomlDocument doc;
+   if (!good() || !check_size()) {
+      diff = toml_diff(previous, doc);
+      this->close();
+      return doc;
+   }
+
+   CTOML_STATS(TomlStatsTimer timer(stats_.parse_ns));
+
+   // Split the source into sections, which are reused if previous was parsed
+   // from the same text. A malformed source is treated as a single section.
+   std::vector<const char *> sections;
+   std::vector<int> lines;
+   if (!find_sections(begin_, end_, sections, lines)) sections.assign(1, begin_);
+
+   // Reusing values from an arena would keep all of the previous arena alive
+   bool reuse = !previous.arena();
+   const char *end = end_;
+   std::vector<TomlDocument::Section> parsed_sections;
+
+   Builder builder(*this, &doc, nullptr);
+   for (size_t i = 0; i < sections.size(); i++) {
+      // Parse up to the end of this section only
+      end_ = i + 1 < sections.size() ? sections[i + 1] : end;
+
+      size_t size = end_ - sections[i];
+      TomlDocument::Section section = { toml_hash_bytes(sections[i], size), doc.size(), 0,
+         static_cast<size_t>(sections[i] - begin_), size };
+      const TomlDocument::Section *unchanged = reuse ? previous.find_section(section.hash, sections[i], size) : nullptr;
+      if (unchanged && !replay_fits(previous, *unchanged)) unchanged = nullptr;
 
+      if (unchanged) replay_section(builder, previous, *unchanged);
+      else parse_entries(builder);
+
+      section.num_slots = doc.size() - section.first_slot;
+      parsed_sections.push_back(section);
+
+      // Errors mean parsing again below, so there's no point going on
+      if (!success()) break;
+   }
+   end_ = end;
+
+   if (!success()) {
+      // Parse again in one go, so that error recovery is exactly that of parse()
+      reset(begin_, end_ - begin_);
+      doc = TomlDocument();
+
+      Builder serial_builder(*this, &doc, nullptr);
+      parse_entries(serial_builder);
+   } else {
+      std::sort(parsed_sections.begin(), parsed_sections.end());
+      doc.sections_.swap(parsed_sections);
+      doc.source_ = std::make_shared<const std::string>(begin_, end_);
+   }
+
+   // Compare with previous, sharing the values that have not changed. Values
+   // from unchanged sections are already shared, so they are never compared.
+   diff = TomlDiff();
+   size_t num_kept = 0;
+   for (auto &entry : doc.values_) {
+      size_t slot = previous.find_slot(entry.first.data(), entry.first.size());
+      if (slot == TomlTable::npos) {
+         diff.added.push_back(entry.first);
+         continue;
+      }
+
+      num_kept++;
+      const std::shared_ptr<TomlValue> &old_value = previous.values_[slot].second;
+      if (old_value == entry.second) continue;
+
+      if (!toml_values_equal(*old_value, *entry.second)) diff.changed.push_back(entry.first);
+      else if (reuse) entry.second = old_value;
+   }
+
+   if (num_kept != previous.size()) {
+      for (auto &entry : previous.values_) {
+         if (!doc.is_key(entry.first)) diff.removed.push_back(entry.first);
+      }
+   }
+
+   this->close();
    return doc;
 }
 
+TomlDocument TomlParser::reparse_buffer(const TomlDocument &previous, const char *data, size_t size,
+   TomlDiff &diff) {
+   close();
+   reset(data, size);
+   stats_.clear();
+
+   return reparse(previous, diff);
+}
+
+void TomlParser::parse(TomlHandler &handler) {
+   if (!good()) return;
+
+   if (!check_size()) {
+      this->close();
+      return;
+   }
+
+   CTOML_STATS(TomlStatsTimer timer(stats_.parse_ns));
+   parse_entries(handler);
+   this->close();
+}
+
+void TomlParser::parse_buffer(const char *data, size_t size, TomlHandler &handler) {
+   close();
+   reset(data, size);
+   stats_.clear();
+
+   parse(handler);
+}
+
+void TomlParser::parse_buffer(const std::string &source, TomlHandler &handler) {
+   parse_buffer(source.data(), source.size(), handler);
+}
+
+std::vector<TomlParseResult> TomlParser::parse_all(const std::vector<std::string> &filenames,
+   unsigned num_threads) const {
+   std::vector<TomlParseResult> results(filenames.size());
+
+   toml_parallel_for(filenames.size(), num_threads, [&](size_t i) {
+      TomlParser parser;
+      parser.copy_settings(*this);
+
+      TomlParseResult &result = results[i];
+      result.filename = filenames[i];
+      result.good = parser.open(filenames[i]);
+      if (result.good) {
+         result.document = parser.parse();
+         for (size_t e = 0; e < parser.num_errors(); e++) result.errors.push_back(parser.get_error(static_cast<int>(e)));
+         result.stats = parser.stats_;
+      }
+   });
+
+   return results;
+}
+
+void TomlParser::copy_settings(const TomlParser &other) {
+   use_arena_ = other.use_arena_;
+   resource_ = other.resource_;
+   max_errors_ = other.max_errors_;
+   limits_ = other.limits_;
+}
+
 bool TomlParser::good() const {
-   return source_file_.good();
+   return begin_ != nullptr;
 }
 
 bool TomlParser::success() const {
@@ -384,12 +1435,19 @@ bool TomlParser::success() const {
 }
 
 bool TomlParser::open(const std::string filename) {
-   source_file_.open(filename);
-   cur_ = new char(' '); // Dummy value
+   close();
+   stats_.clear();
+
+   CTOML_STATS(TomlStatsTimer timer(stats_.open_ns));
+   source_file_ = std::make_shared<TomlMappedFile>();
+   if (source_file_->open(filename)) {
+      reset(source_file_->data(), source_file_->size());
+   }
 
-   return source_file_.good();
+   return good();
 }
 
 void TomlParser::close() {
-    source_file_.close();
+   source_file_.reset();
+   begin_ = pos_ = end_ = nullptr;
 }
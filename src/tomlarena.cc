@@ -0,0 +1,42 @@
+#include "include/tomlarena.h"
+
+#include <cstdint>
+
+using namespace ctoml;
+
+TomlArena::TomlArena(size_t block_size, TomlMemoryResource *upstream) : upstream_(upstream),
+   cur_(nullptr), end_(nullptr), block_size_(block_size), bytes_allocated_(0), cleanups_(nullptr) { }
+
+TomlArena::TomlArena(TomlMemoryResource *upstream, size_t block_size) : upstream_(upstream),
+   cur_(nullptr), end_(nullptr), block_size_(block_size), bytes_allocated_(0), cleanups_(nullptr) { }
+
+TomlArena::~TomlArena() {
+   for (Cleanup *c = cleanups_; c; c = c->next) {
+      c->destroy(c->object);
+   }
+
+   for (auto &block : blocks_) {
+      upstream_->deallocate(block.data, block.size);
+   }
+}
+
+void *TomlArena::allocate(size_t size, size_t align) {
+   std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(cur_) + align - 1) & ~(std::uintptr_t)(align - 1);
+
+   if (!cur_ || p + size > reinterpret_cast<std::uintptr_t>(end_)) {
+      // Start a new block. Oversized requests get a block of their own.
+      size_t block_size = size + align > block_size_ ? size + align : block_size_;
+      char *block = static_cast<char *>(upstream_->allocate(block_size));
+      Block entry = { block, block_size };
+      blocks_.push_back(entry);
+
+      cur_ = block;
+      end_ = block + block_size;
+      p = (reinterpret_cast<std::uintptr_t>(cur_) + align - 1) & ~(std::uintptr_t)(align - 1);
+   }
+
+   cur_ = reinterpret_cast<char *>(p + size);
+   bytes_allocated_ += size;
+
+   return reinterpret_cast<void *>(p);
+}
@@ -0,0 +1,244 @@
+#include "include/tomlcompact.h"
+#include "include/toml.h"
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+using namespace ctoml;
+
+TomlCompactDocument::TomlCompactDocument() : arena_(std::make_shared<TomlArena>()) { }
+
+TomlCompactDocument::TomlCompactDocument(const TomlDocument &doc) : arena_(std::make_shared<TomlArena>()) {
+   values_.reserve(doc.size());
+
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) {
+      values_.emplace(it->first, convert(*it->second));
+   }
+}
+
+// Builds compact values from parse events
+class TomlCompactDocument::Builder : public TomlHandler {
+   TomlCompactDocument &doc_;
+   TomlParser &parser_;
+
+   std::string group_, key_;
+   const char *key_at_; // Where the key is in the source
+
+   // Every key group, given by a header or a dotted key. As in a TomlDocument,
+   // a name can't be both a group and a value.
+   std::unordered_set<std::string> tables_;
+
+   // Elements of the arrays the current value is nested in. Levels are kept
+   // once used, so their capacity is reused by the next array.
+   std::vector<std::vector<TomlCompactValue>> arrays_;
+   size_t depth_;
+
+   void error(TomlErrorCode code, const std::string &text, const std::string &detail = std::string()) {
+      parser_.error_at(code, parser_.line_of(key_at_), key_at_, text, detail);
+   }
+
+   // Returns false, reporting an error, if the key or a group it is in is
+   // already a value, or the key is already a group
+   bool check_key() {
+      for (size_t dot = key_.find('.'); dot != std::string::npos; dot = key_.find('.', dot + 1)) {
+         std::string prefix = key_.substr(0, dot);
+         if (doc_.values_.count(prefix)) {
+            error(TomlErrorCode::DuplicateKey, prefix);
+            return false;
+         }
+         tables_.insert(prefix);
+      }
+
+      if (doc_.values_.count(key_) || tables_.count(key_)) {
+         error(TomlErrorCode::DuplicateKey, key_);
+         return false;
+      }
+      return true;
+   }
+
+   // Returns false, reporting an error, if a string or array is too long to store
+   bool check_size(size_t size) {
+      if (size <= kMaxSize) return true;
+
+      error(TomlErrorCode::LimitExceeded, "the compact value size", std::to_string(kMaxSize));
+      return false;
+   }
+
+   void add(const TomlCompactValue &value) {
+      if (depth_ > 0) {
+         arrays_[depth_ - 1].push_back(value);
+      } else if (check_key()) {
+         doc_.values_.emplace(key_, value);
+      }
+   }
+public:
+   Builder(TomlCompactDocument &doc, TomlParser &parser) : doc_(doc), parser_(parser), key_at_(nullptr), depth_(0) { }
+
+   void on_table_header(const char *name, size_t len) {
+      group_.assign(name, len);
+
+      // The group exists even if no keys follow. Clashes with values are
+      // reported at its keys.
+      for (size_t dot = group_.find('.'); dot != std::string::npos; dot = group_.find('.', dot + 1)) {
+         tables_.insert(group_.substr(0, dot));
+      }
+      tables_.insert(group_);
+   }
+
+   void on_key(const char *key, size_t len) {
+      key_ = group_;
+      if (!key_.empty()) key_ += '.';
+      key_.append(key, len);
+      key_at_ = key;
+      depth_ = 0;
+   }
+
+   void on_string(const char *str, size_t len) {
+      if (check_size(len)) add(doc_.make_string(str, len));
+   }
+
+   void on_int(std::int64_t value) {
+      TomlCompactValue compact;
+      compact.int_ = value;
+      add(compact);
+   }
+
+   void on_float(double value) {
+      TomlCompactValue compact;
+      compact.type_ = TomlType::Float;
+      compact.float_ = value;
+      add(compact);
+   }
+
+   void on_boolean(bool value) {
+      TomlCompactValue compact;
+      compact.type_ = TomlType::Boolean;
+      compact.boolean_ = value;
+      add(compact);
+   }
+
+   void on_datetime(time_t value) {
+      TomlCompactValue compact;
+      compact.type_ = TomlType::DateTime;
+      compact.datetime_ = value;
+      add(compact);
+   }
+
+   void on_array_begin() {
+      if (arrays_.size() == depth_) arrays_.emplace_back();
+      arrays_[depth_++].clear();
+   }
+
+   void on_array_end() {
+      if (depth_ == 0) return;
+
+      std::vector<TomlCompactValue> &elements = arrays_[--depth_];
+      if (check_size(elements.size())) add(doc_.make_array(elements.data(), elements.size()));
+   }
+};
+
+bool TomlCompactDocument::parse(TomlParser &parser) {
+   values_.clear();
+   arena_ = std::make_shared<TomlArena>();
+
+   Builder builder(*this, parser);
+   parser.parse(builder);
+   return parser.success();
+}
+
+bool TomlCompactDocument::parse_buffer(TomlParser &parser, const char *data, size_t size) {
+   values_.clear();
+   arena_ = std::make_shared<TomlArena>();
+
+   Builder builder(*this, parser);
+   parser.parse_buffer(data, size, builder);
+   return parser.success();
+}
+
+bool TomlCompactDocument::parse_buffer(TomlParser &parser, const std::string &source) {
+   return parse_buffer(parser, source.data(), source.size());
+}
+
+TomlCompactValue TomlCompactDocument::make_string(const char *str, size_t len) {
+   if (len > kMaxSize) throw std::length_error("TomlCompactValue string too long");
+
+   char *data = static_cast<char *>(arena_->allocate(len + 1, 1));
+   memcpy(data, str, len);
+   data[len] = '\0';
+
+   TomlCompactValue compact;
+   compact.type_ = TomlType::String;
+   compact.string_ = data;
+   compact.size_ = static_cast<std::uint32_t>(len);
+   return compact;
+}
+
+TomlCompactValue TomlCompactDocument::make_array(const TomlCompactValue *elements, size_t size) {
+   if (size > kMaxSize) throw std::length_error("TomlCompactValue array too long");
+
+   TomlCompactValue *data = static_cast<TomlCompactValue *>(
+      arena_->allocate(sizeof(TomlCompactValue) * size, alignof(TomlCompactValue)));
+   std::uninitialized_copy(elements, elements + size, data);
+
+   TomlCompactValue compact;
+   compact.type_ = TomlType::Array;
+   compact.array_ = data;
+   compact.size_ = static_cast<std::uint32_t>(size);
+   return compact;
+}
+
+TomlCompactValue TomlCompactDocument::convert(const TomlValue &value) {
+   TomlCompactValue compact;
+   compact.type_ = value.type();
+
+   switch (value.type()) {
+      case TomlType::Int:
+         compact.int_ = static_cast<const TomlInt &>(value).value();
+         break;
+      case TomlType::Float:
+         compact.float_ = static_cast<const TomlFloat &>(value).value();
+         break;
+      case TomlType::Boolean:
+         compact.boolean_ = static_cast<const TomlBoolean &>(value).value();
+         break;
+      case TomlType::DateTime:
+         compact.datetime_ = static_cast<const TomlDateTime &>(value).value();
+         break;
+      case TomlType::String: {
+         const TomlString &str = static_cast<const TomlString &>(value);
+         return make_string(str.data(), str.size());
+      }
+      case TomlType::Array: {
+         const TomlArray &array = static_cast<const TomlArray &>(value);
+         std::vector<TomlCompactValue> elements(array.size());
+
+         // Unboxed elements are converted straight from their storage
+         for (size_t i = 0; i < array.int_span().size(); i++) elements[i].int_ = array.int_span()[i];
+         for (size_t i = 0; i < array.float_span().size(); i++) {
+            elements[i].type_ = TomlType::Float;
+            elements[i].float_ = array.float_span()[i];
+         }
+         for (size_t i = 0; i < array.bool_span().size(); i++) {
+            elements[i].type_ = TomlType::Boolean;
+            elements[i].boolean_ = array.bool_span()[i] != 0;
+         }
+
+         if (array.int_span().empty() && array.float_span().empty() && array.bool_span().empty()) {
+            for (size_t i = 0; i < array.size(); i++) elements[i] = convert(*array.at(static_cast<int>(i)));
+         }
+
+         return make_array(elements.data(), elements.size());
+      }
+   }
+
+   return compact;
+}
+
+const TomlCompactValue *TomlCompactDocument::get(const std::string &key) const {
+   auto it = values_.find(key);
+   return it != values_.end() ? &it->second : nullptr;
+}
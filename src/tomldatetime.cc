@@ -0,0 +1,136 @@
+#include "include/tomldatetime.h"
+#include "include/tomlscan.h"
+
+#include <cstdint>
+
+using namespace ctoml;
+
+static const std::int64_t kSecondsPerDay = 86400;
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar. Counts
+// from March so the leap day falls at the end of the year; see Howard Hinnant's
+// "chrono-Compatible Low-Level Date Algorithms".
+static std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) {
+   y -= m <= 2;
+   std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+   unsigned yoe = static_cast<unsigned>(y - era * 400);
+   unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+   unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+   return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+// The inverse of days_from_civil
+static void civil_from_days(std::int64_t z, std::int64_t *y, unsigned *m, unsigned *d) {
+   z += 719468;
+   std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+   unsigned doe = static_cast<unsigned>(z - era * 146097);
+   unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+   unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+   unsigned mp = (5 * doy + 2) / 153;
+
+   *d = doy - (153 * mp + 2) / 5 + 1;
+   *m = mp < 10 ? mp + 3 : mp - 9;
+   *y = static_cast<std::int64_t>(yoe) + era * 400 + (*m <= 2);
+}
+
+static bool is_leap_year(unsigned y) {
+   return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+static unsigned days_in_month(unsigned y, unsigned m) {
+   static const unsigned kDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+   return m == 2 && is_leap_year(y) ? 29 : kDays[m - 1];
+}
+
+// Reads a fixed number of digits, or returns false
+static bool read_digits(const char *p, int count, unsigned *value) {
+   unsigned n = 0;
+   for (int i = 0; i < count; i++) {
+      if (!toml_is_digit(p[i])) return false;
+      n = n * 10 + (p[i] - '0');
+   }
+
+   *value = n;
+   return true;
+}
+
+// Writes a fixed number of digits, most significant first
+static void write_digits(char *p, int count, unsigned value) {
+   for (int i = count - 1; i >= 0; i--) {
+      p[i] = static_cast<char>('0' + value % 10);
+      value /= 10;
+   }
+}
+
+bool ctoml::toml_parse_datetime(const char *begin, const char *end, time_t *value) {
+   if (end - begin != static_cast<std::ptrdiff_t>(kTomlDateTimeLength)) return false;
+
+   const char *s = begin;
+   if (s[4] != '-' || s[7] != '-' || s[10] != 'T' || s[13] != ':' || s[16] != ':' || s[19] != 'Z') {
+      return false;
+   }
+
+   unsigned year, mon, mday, hour, min, sec;
+   if (!read_digits(s, 4, &year) || !read_digits(s + 5, 2, &mon) || !read_digits(s + 8, 2, &mday) ||
+      !read_digits(s + 11, 2, &hour) || !read_digits(s + 14, 2, &min) || !read_digits(s + 17, 2, &sec)) {
+      return false;
+   }
+
+   // A seconds value of 60 is allowed for leap seconds, and rolls into the next minute
+   if (mon < 1 || mon > 12 || mday < 1 || mday > days_in_month(year, mon)) return false;
+   if (hour > 23 || min > 59 || sec > 60) return false;
+
+   *value = static_cast<time_t>(days_from_civil(year, mon, mday) * kSecondsPerDay +
+      hour * 3600 + min * 60 + sec);
+   return true;
+}
+
+size_t ctoml::toml_format_datetime(time_t value, char *buf) {
+   std::int64_t t = static_cast<std::int64_t>(value);
+
+   // Split into days and seconds of the day, rounding the days down
+   std::int64_t days = t / kSecondsPerDay, secs = t % kSecondsPerDay;
+   if (secs < 0) {
+      secs += kSecondsPerDay;
+      days--;
+   }
+
+   std::int64_t year;
+   unsigned mon, mday;
+   civil_from_days(days, &year, &mon, &mday);
+
+   // Years outside what four digits can hold are clamped; TOML can't express them
+   if (year < 0) year = 0;
+   if (year > 9999) year = 9999;
+
+   write_digits(buf, 4, static_cast<unsigned>(year));
+   buf[4] = '-';
+   write_digits(buf + 5, 2, mon);
+   buf[7] = '-';
+   write_digits(buf + 8, 2, mday);
+   buf[10] = 'T';
+   write_digits(buf + 11, 2, static_cast<unsigned>(secs / 3600));
+   buf[13] = ':';
+   write_digits(buf + 14, 2, static_cast<unsigned>(secs / 60 % 60));
+   buf[16] = ':';
+   write_digits(buf + 17, 2, static_cast<unsigned>(secs % 60));
+   buf[19] = 'Z';
+   buf[20] = '\0';
+
+   return kTomlDateTimeLength;
+}
+
+time_t ctoml::toml_time_from_tm(const tm &time) {
+   // Normalise the month into the year first, like timegm
+   std::int64_t year = static_cast<std::int64_t>(time.tm_year) + 1900 + time.tm_mon / 12;
+   int mon = time.tm_mon % 12;
+   if (mon < 0) {
+      mon += 12;
+      year--;
+   }
+
+   // Out of range days, hours and so on just carry through the arithmetic
+   std::int64_t days = days_from_civil(year, mon + 1, 1) + time.tm_mday - 1;
+   return static_cast<time_t>(days * kSecondsPerDay + static_cast<std::int64_t>(time.tm_hour) * 3600 +
+      time.tm_min * 60 + time.tm_sec);
+}
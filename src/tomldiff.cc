@@ -0,0 +1,73 @@
+#include "include/tomldiff.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace ctoml;
+
+bool ctoml::toml_values_equal(const TomlValue &a, const TomlValue &b) {
+   if (&a == &b) return true;
+   if (a.type() != b.type()) return false;
+
+   switch (a.type()) {
+      case TomlType::String: {
+         const TomlString &x = static_cast<const TomlString &>(a), &y = static_cast<const TomlString &>(b);
+         return x.size() == y.size() && memcmp(x.data(), y.data(), x.size()) == 0;
+      }
+      case TomlType::Int:
+         return static_cast<const TomlInt &>(a).value() == static_cast<const TomlInt &>(b).value();
+      case TomlType::Float:
+         return static_cast<const TomlFloat &>(a).value() == static_cast<const TomlFloat &>(b).value();
+      case TomlType::Boolean:
+         return static_cast<const TomlBoolean &>(a).value() == static_cast<const TomlBoolean &>(b).value();
+      case TomlType::DateTime:
+         return static_cast<const TomlDateTime &>(a).value() == static_cast<const TomlDateTime &>(b).value();
+      case TomlType::Array: {
+         const TomlArray &x = static_cast<const TomlArray &>(a);
+         const TomlArray &y = static_cast<const TomlArray &>(b);
+         if (x.size() != y.size()) return false;
+
+         // Compare unboxed elements in place
+         if (!x.int_span().empty() && !y.int_span().empty()) {
+            return std::equal(x.int_span().begin(), x.int_span().end(), y.int_span().begin());
+         }
+         if (!x.float_span().empty() && !y.float_span().empty()) {
+            return std::equal(x.float_span().begin(), x.float_span().end(), y.float_span().begin());
+         }
+         if (!x.bool_span().empty() && !y.bool_span().empty()) {
+            return std::equal(x.bool_span().begin(), x.bool_span().end(), y.bool_span().begin());
+         }
+
+         // Arrays of a single primitive type are always unboxed, so an unboxed
+         // array can't equal a boxed one
+         if (!x.int_span().empty() || !x.float_span().empty() || !x.bool_span().empty() ||
+            !y.int_span().empty() || !y.float_span().empty() || !y.bool_span().empty()) {
+            return false;
+         }
+
+         for (size_t i = 0; i < x.size(); i++) {
+            if (!toml_values_equal(*x.at(static_cast<int>(i)), *y.at(static_cast<int>(i)))) return false;
+         }
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+TomlDiff ctoml::toml_diff(const TomlDocument &before, const TomlDocument &after) {
+   TomlDiff diff;
+
+   for (auto it = after.cbegin(); it != after.cend(); ++it) {
+      const TomlValue *old_value = before.find(it->first);
+      if (!old_value) diff.added.push_back(it->first);
+      else if (!toml_values_equal(*old_value, *it->second)) diff.changed.push_back(it->first);
+   }
+
+   for (auto it = before.cbegin(); it != before.cend(); ++it) {
+      if (!after.is_key(it->first)) diff.removed.push_back(it->first);
+   }
+
+   return diff;
+}
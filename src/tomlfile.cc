@@ -0,0 +1,81 @@
+#include "include/tomlfile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ctoml;
+
+TomlMappedFile::TomlMappedFile() : data_(nullptr), size_(0), mapped_(false), good_(false) { }
+
+TomlMappedFile::~TomlMappedFile() {
+   close();
+}
+
+bool TomlMappedFile::open(const std::string &filename) {
+   close();
+
+#ifdef _WIN32
+   std::ifstream in(filename, std::ios::in | std::ios::binary);
+   if (!in.good()) return false;
+
+   std::ostringstream contents;
+   contents << in.rdbuf();
+   buffer_ = contents.str();
+
+   data_ = buffer_.data();
+   size_ = buffer_.size();
+#else
+   int fd = ::open(filename.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+
+   struct stat st;
+   if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return false;
+   }
+
+   size_ = static_cast<size_t>(st.st_size);
+   if (size_ > 0) {
+      void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+         ::close(fd);
+         size_ = 0;
+         return false;
+      }
+
+      // We read the whole file front to back
+      madvise(addr, size_, MADV_SEQUENTIAL);
+
+      data_ = static_cast<const char *>(addr);
+      mapped_ = true;
+   } else {
+      // mmap cannot map an empty file
+      data_ = buffer_.data();
+   }
+
+   // The mapping stays valid after the descriptor is closed
+   ::close(fd);
+#endif
+
+   good_ = true;
+   return true;
+}
+
+void TomlMappedFile::close() {
+#ifndef _WIN32
+   if (mapped_) munmap(const_cast<char *>(data_), size_);
+#endif
+
+   buffer_.clear();
+   data_ = nullptr;
+   size_ = 0;
+   mapped_ = false;
+   good_ = false;
+}
@@ -0,0 +1,35 @@
+#include "include/tomllazy.h"
+
+using namespace ctoml;
+
+const std::shared_ptr<TomlValue> &TomlLazyDocument::decode(size_t slot) const {
+   std::shared_ptr<TomlValue> &value = index_.values_[slot].second;
+   if (!value) {
+      const Span &span = spans_[slot];
+      value = TomlParser::decode_value(span.begin, span.end, span.line, resource_);
+      if (value) num_decoded_++;
+   }
+
+   return value;
+}
+
+size_t TomlLazyDocument::num_decoded() const {
+   std::lock_guard<std::mutex> lock(*mutex_);
+   return num_decoded_;
+}
+
+const TomlValue *TomlLazyDocument::find(const char *key, size_t len) const {
+   size_t slot = index_.find_slot(key, len);
+   if (slot == TomlTable::npos) return nullptr;
+
+   std::lock_guard<std::mutex> lock(*mutex_);
+   return decode(slot).get();
+}
+
+std::shared_ptr<TomlValue> TomlLazyDocument::get(const char *key, size_t len) const {
+   size_t slot = index_.find_slot(key, len);
+   if (slot == TomlTable::npos) return nullptr;
+
+   std::lock_guard<std::mutex> lock(*mutex_);
+   return decode(slot);
+}
@@ -0,0 +1,22 @@
+#include "include/tomlmemory.h"
+
+using namespace ctoml;
+
+namespace {
+   class TomlNewDeleteResource : public TomlMemoryResource {
+   protected:
+      void *do_allocate(size_t size, size_t) {
+         return ::operator new(size);
+      }
+
+      void do_deallocate(void *p, size_t, size_t) {
+         ::operator delete(p);
+      }
+   };
+}
+
+TomlMemoryResource *ctoml::toml_default_resource() {
+   // Never destroyed, so values in static documents can still be freed at exit
+   static TomlNewDeleteResource *resource = new TomlNewDeleteResource();
+   return resource;
+}
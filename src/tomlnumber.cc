@@ -0,0 +1,100 @@
+#include "include/tomlnumber.h"
+#include "include/tomlscan.h"
+
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+
+using namespace ctoml;
+
+// Powers of ten that are exactly representable as a double
+static const double kExactPowersOfTen[] = {
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Mantissas up to 2^53 convert to a double exactly
+static const std::uint64_t kMaxExactMantissa = 1ULL << 53;
+
+TomlNumberResult ctoml::toml_parse_int(const char *begin, const char *end, std::int64_t *value) {
+   const char *p = begin;
+   bool negative = p < end && *p == '-';
+   if (negative) ++p;
+   if (p == end) return TomlNumberResult::Invalid;
+
+   // The magnitude of INT64_MIN is one more than INT64_MAX
+   const std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) +
+      (negative ? 1 : 0);
+
+   std::uint64_t n = 0;
+   bool overflow = false;
+   for (; p < end; ++p) {
+      if (!toml_is_digit(*p)) return TomlNumberResult::Invalid;
+
+      unsigned digit = *p - '0';
+      if (n > (limit - digit) / 10) overflow = true;
+      else n = n * 10 + digit;
+   }
+
+   if (overflow) return TomlNumberResult::OutOfRange;
+
+   // Negate in unsigned arithmetic so that INT64_MIN does not overflow
+   *value = negative ? static_cast<std::int64_t>(0 - n) : static_cast<std::int64_t>(n);
+   return TomlNumberResult::Ok;
+}
+
+TomlNumberResult ctoml::toml_parse_float(const char *begin, const char *end, double *value) {
+   const char *p = begin;
+   bool negative = p < end && *p == '-';
+   if (negative) ++p;
+
+   // Collect up to 19 significant digits, which always fit in 64 bits
+   std::uint64_t mantissa = 0;
+   int num_digits = 0, significant = 0, exponent = 0;
+   bool decimal = false, truncated = false;
+   for (; p < end; ++p) {
+      if (*p == '.') {
+         if (decimal) return TomlNumberResult::Invalid; // Double decimal point
+         decimal = true;
+         continue;
+      }
+
+      if (!toml_is_digit(*p)) return TomlNumberResult::Invalid;
+      num_digits++;
+
+      if (significant == 0 && *p == '0') {
+         // Leading zeros don't count towards the precision
+         if (decimal) exponent--;
+      } else if (significant < 19) {
+         mantissa = mantissa * 10 + (*p - '0');
+         significant++;
+         if (decimal) exponent--;
+      } else {
+         truncated = true;
+         if (!decimal) exponent++;
+      }
+   }
+
+   if (num_digits == 0) return TomlNumberResult::Invalid;
+
+   // Exact when both the mantissa and the power of ten are exact doubles, since the
+   // result is then a single correctly rounded operation
+   if (!truncated && mantissa <= kMaxExactMantissa && exponent >= -22 && exponent <= 22) {
+      double d = static_cast<double>(mantissa);
+      d = exponent < 0 ? d / kExactPowersOfTen[-exponent] : d * kExactPowersOfTen[exponent];
+      *value = negative ? -d : d;
+      return TomlNumberResult::Ok;
+   }
+
+   // Otherwise let the standard library round it, in the classic locale
+   std::istringstream stream(std::string(begin, end));
+   stream.imbue(std::locale::classic());
+
+   double d;
+   stream >> d;
+   if (stream.fail()) return TomlNumberResult::OutOfRange;
+
+   *value = d;
+   return TomlNumberResult::Ok;
+}
@@ -0,0 +1,323 @@
+#include "include/tomlscan.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define CTOML_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if CTOML_SSE2 && (defined(__x86_64__) || defined(__i386__))
+#define CTOML_AVX2 1
+#include <immintrin.h>
+#endif
+
+using namespace ctoml;
+
+// Scalar versions, used for short tails and on other architectures
+
+static const char *skip_spaces_scalar(const char *p, const char *end) {
+   while (p < end && toml_is_space(*p)) ++p;
+   return p;
+}
+
+static const char *find_quote_or_escape_scalar(const char *p, const char *end) {
+   while (p < end && *p != '"' && *p != '\\') ++p;
+   return p;
+}
+
+static inline bool is_escapable(char c) {
+   return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20 || c == 0x7F;
+}
+
+static const char *find_escapable_scalar(const char *p, const char *end) {
+   while (p < end && !is_escapable(*p)) ++p;
+   return p;
+}
+
+static inline bool is_structural(char c) {
+   return c == '"' || c == '\\' || c == '\n' || c == '#' || c == '=' || c == '[' || c == ']';
+}
+
+static const char *find_structural_scalar(const char *p, const char *end) {
+   while (p < end && !is_structural(*p)) ++p;
+   return p;
+}
+
+#if CTOML_SSE2
+
+// Each helper returns a bitmask with a bit set for every byte of x in the class
+
+static inline int space_mask_sse2(__m128i x) {
+   // ' ', or '\t' <= c <= '\r' (checked as an unsigned c - '\t' <= 4)
+   __m128i t = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+   __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+   return _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(x, _mm_set1_epi8(' '))));
+}
+
+static inline int quote_or_escape_mask_sse2(__m128i x) {
+   return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')),
+      _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))));
+}
+
+static inline int escapable_mask_sse2(__m128i x) {
+   // Control characters are those with unsigned c <= 0x1F, or DEL
+   __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7F)));
+   return _mm_movemask_epi8(m);
+}
+
+static inline int structural_mask_sse2(__m128i x) {
+   __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('#')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('=')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('[')));
+   m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(']')));
+   return _mm_movemask_epi8(m);
+}
+
+static const char *skip_spaces_sse2(const char *p, const char *end) {
+   for (; end - p >= 16; p += 16) {
+      int mask = ~space_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) & 0xFFFF;
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return skip_spaces_scalar(p, end);
+}
+
+static const char *find_quote_or_escape_sse2(const char *p, const char *end) {
+   for (; end - p >= 16; p += 16) {
+      int mask = quote_or_escape_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_quote_or_escape_scalar(p, end);
+}
+
+static const char *find_escapable_sse2(const char *p, const char *end) {
+   for (; end - p >= 16; p += 16) {
+      int mask = escapable_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_escapable_scalar(p, end);
+}
+
+static const char *find_structural_sse2(const char *p, const char *end) {
+   for (; end - p >= 16; p += 16) {
+      int mask = structural_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_structural_scalar(p, end);
+}
+
+#endif
+
+#if CTOML_AVX2
+
+__attribute__((target("avx2")))
+static const char *skip_spaces_avx2(const char *p, const char *end) {
+   const __m256i tab = _mm256_set1_epi8('\t'), four = _mm256_set1_epi8(4), space = _mm256_set1_epi8(' ');
+
+   for (; end - p >= 32; p += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      __m256i t = _mm256_sub_epi8(x, tab);
+      __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(t, four), t),
+         _mm256_cmpeq_epi8(x, space));
+
+      unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(spaces));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return skip_spaces_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_quote_or_escape_avx2(const char *p, const char *end) {
+   const __m256i quote = _mm256_set1_epi8('"'), escape = _mm256_set1_epi8('\\');
+
+   for (; end - p >= 32; p += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+         _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, escape))));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_quote_or_escape_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_escapable_avx2(const char *p, const char *end) {
+   for (; end - p >= 32; p += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+         _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(0x7F)));
+
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_escapable_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_structural_avx2(const char *p, const char *end) {
+   for (; end - p >= 32; p += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+         _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('#')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('=')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')));
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']')));
+
+      unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+      if (mask) return p + __builtin_ctz(mask);
+   }
+
+   return find_structural_sse2(p, end);
+}
+
+#endif
+
+namespace {
+   typedef const char *(*ScanFunction)(const char *, const char *);
+
+   // The best implementation of each scan for this CPU
+   struct ScanFunctions {
+      ScanFunction skip_spaces;
+      ScanFunction find_quote_or_escape;
+      ScanFunction find_escapable;
+      ScanFunction find_structural;
+
+      ScanFunctions() {
+#if CTOML_AVX2
+         __builtin_cpu_init();
+         if (__builtin_cpu_supports("avx2")) {
+            skip_spaces = skip_spaces_avx2;
+            find_quote_or_escape = find_quote_or_escape_avx2;
+            find_escapable = find_escapable_avx2;
+            find_structural = find_structural_avx2;
+            return;
+         }
+#endif
+#if CTOML_SSE2
+         skip_spaces = skip_spaces_sse2;
+         find_quote_or_escape = find_quote_or_escape_sse2;
+         find_escapable = find_escapable_sse2;
+         find_structural = find_structural_sse2;
+#else
+         skip_spaces = skip_spaces_scalar;
+         find_quote_or_escape = find_quote_or_escape_scalar;
+         find_escapable = find_escapable_scalar;
+         find_structural = find_structural_scalar;
+#endif
+      }
+   };
+
+   // Selected once, on first use
+   const ScanFunctions &scan_functions() {
+      static const ScanFunctions functions;
+      return functions;
+   }
+}
+
+const char *ctoml::toml_skip_spaces(const char *p, const char *end) {
+   // Often there is nothing to skip, so check that before dispatching
+   if (p < end && !toml_is_space(*p)) return p;
+   return scan_functions().skip_spaces(p, end);
+}
+
+const char *ctoml::toml_find_quote_or_escape(const char *p, const char *end) {
+   return scan_functions().find_quote_or_escape(p, end);
+}
+
+const char *ctoml::toml_find_escapable(const char *p, const char *end) {
+   return scan_functions().find_escapable(p, end);
+}
+
+const char *ctoml::toml_find_structural(const char *p, const char *end) {
+   return scan_functions().find_structural(p, end);
+}
+
+const char *ctoml::toml_find_newline(const char *p, const char *end) {
+   // memchr is already vectorised by the C library
+   const void *nl = p < end ? memchr(p, '\n', end - p) : nullptr;
+   return nl ? static_cast<const char *>(nl) : end;
+}
+
+int ctoml::toml_count_newlines(const char *p, const char *end) {
+   int count = 0;
+   while ((p = toml_find_newline(p, end)) < end) {
+      count++;
+      p++;
+   }
+
+   return count;
+}
+
+namespace {
+   // XXH64's primes
+   const std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL, kPrime2 = 0xC2B2AE3D27D4EB4FULL,
+      kPrime3 = 0x165667B19E3779F9ULL, kPrime4 = 0x85EBCA77C2B2AE63ULL, kPrime5 = 0x27D4EB2F165667C5ULL;
+
+   inline std::uint64_t rotl(std::uint64_t x, int r) {
+      return (x << r) | (x >> (64 - r));
+   }
+
+   inline std::uint64_t read64(const char *p) {
+      std::uint64_t word;
+      memcpy(&word, p, 8);
+      return word;
+   }
+
+   inline std::uint64_t hash_round(std::uint64_t acc, std::uint64_t word) {
+      return rotl(acc + word * kPrime2, 31) * kPrime1;
+   }
+
+   inline std::uint64_t hash_merge(std::uint64_t h, std::uint64_t acc) {
+      return (h ^ hash_round(0, acc)) * kPrime1 + kPrime4;
+   }
+}
+
+std::uint64_t ctoml::toml_hash_bytes(const char *p, size_t len) {
+   const char *end = p + len;
+   std::uint64_t h;
+
+   if (len >= 32) {
+      // Four lanes, each taking every fourth word
+      std::uint64_t acc[4] = { kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1 };
+      for (; end - p >= 32; p += 32) {
+         for (int lane = 0; lane < 4; lane++) acc[lane] = hash_round(acc[lane], read64(p + lane * 8));
+      }
+
+      h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+      for (int lane = 0; lane < 4; lane++) h = hash_merge(h, acc[lane]);
+   }
+   else h = kPrime5;
+
+   h += len;
+
+   // The tail, a word, half word and byte at a time
+   for (; end - p >= 8; p += 8) h = rotl(h ^ hash_round(0, read64(p)), 27) * kPrime1 + kPrime4;
+   if (end - p >= 4) {
+      std::uint32_t half;
+      memcpy(&half, p, 4);
+      h = rotl(h ^ half * kPrime1, 23) * kPrime2 + kPrime3;
+      p += 4;
+   }
+   for (; p < end; p++) h = rotl(h ^ static_cast<unsigned char>(*p) * kPrime5, 11) * kPrime1;
+
+   // Spread every input bit over the whole result
+   h ^= h >> 33;
+   h *= kPrime2;
+   h ^= h >> 29;
+   h *= kPrime3;
+   return h ^ (h >> 32);
+}
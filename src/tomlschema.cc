@@ -0,0 +1,116 @@
+#include "include/tomlschema.h"
+
+#include <algorithm>
+
+using namespace ctoml;
+
+void TomlBinder::Fields::add(Field field) {
+   std::uint64_t hash = TomlTable::hash(field.key.data(), field.key.size());
+   auto entry = std::make_pair(hash, fields_.size());
+   index_.insert(std::upper_bound(index_.begin(), index_.end(), entry), entry);
+   fields_.push_back(field);
+}
+
+int TomlBinder::Fields::find(const char *key, size_t len) const {
+   std::uint64_t hash = TomlTable::hash(key, len);
+   auto it = std::lower_bound(index_.begin(), index_.end(), std::make_pair(hash, static_cast<size_t>(0)));
+
+   for (; it != index_.end() && it->first == hash; ++it) {
+      const std::string &name = fields_[it->second].key;
+      if (name.size() == len && name.compare(0, len, key, len) == 0) return static_cast<int>(it->second);
+   }
+
+   return -1;
+}
+
+TomlBinder::TomlBinder(TomlParser &parser, const Fields &fields, void *object)
+   : parser_(parser), fields_(fields), object_(object), seen_(fields.size()), field_(-1), key_line_(0) { }
+
+void TomlBinder::on_table_header(const char *name, size_t len) {
+   group_.assign(name, len);
+   frames_.clear();
+   tables_.insert(std::make_pair(group_, parser_.position_of(name)));
+}
+
+void TomlBinder::on_key(const char *key, size_t len) {
+   key_ = group_;
+   if (!key_.empty()) key_ += '.';
+   key_.append(key, len);
+   key_line_ = parser_.line();
+
+   // Keys that are not in the schema get a frame that ignores their value
+   Frame frame = { nullptr, nullptr, false };
+   field_ = fields_.find(key_.data(), key_.size());
+   if (field_ >= 0) {
+      seen_[field_] = true;
+      frame.sink = fields_[field_].sink.get();
+      frame.target = fields_[field_].member(object_);
+   }
+
+   frames_.assign(1, frame);
+}
+
+void TomlBinder::mismatch() {
+   const Field &field = fields_[field_];
+   parser_.error_at(TomlErrorCode::TypeMismatch, key_line_, nullptr, field.key, field.sink->expected());
+
+   // Ignore the rest of the value
+   for (auto &frame : frames_) frame.sink = nullptr;
+}
+
+void TomlBinder::on_string(const char *str, size_t len) {
+   store([&](const TomlFieldSink *sink, void *target) { return sink->store_string(target, str, len); });
+}
+
+void TomlBinder::on_int(std::int64_t value) {
+   store([&](const TomlFieldSink *sink, void *target) { return sink->store_int(target, value); });
+}
+
+void TomlBinder::on_float(double value) {
+   store([&](const TomlFieldSink *sink, void *target) { return sink->store_float(target, value); });
+}
+
+void TomlBinder::on_boolean(bool value) {
+   store([&](const TomlFieldSink *sink, void *target) { return sink->store_boolean(target, value); });
+}
+
+void TomlBinder::on_datetime(time_t value) {
+   store([&](const TomlFieldSink *sink, void *target) { return sink->store_datetime(target, value); });
+}
+
+void TomlBinder::on_array_begin() {
+   Frame frame = { nullptr, nullptr, true };
+
+   if (!frames_.empty() && frames_.back().sink) {
+      const Frame &outer = frames_.back();
+      const TomlFieldSink *sink = outer.array ? outer.sink->element() : outer.sink;
+
+      if (sink->element()) {
+         // The array is either the member itself or a new element of the outer array
+         frame.sink = sink;
+         frame.target = outer.array ? outer.sink->append(outer.target) : outer.target;
+         sink->clear(frame.target);
+      } else {
+         mismatch();
+      }
+   }
+
+   frames_.push_back(frame);
+}
+
+void TomlBinder::on_array_end() {
+   if (frames_.size() > 1) frames_.pop_back();
+}
+
+void TomlBinder::finish() {
+   for (size_t i = 0; i < fields_.size(); i++) {
+      if (!fields_[i].required || seen_[i]) continue;
+
+      const std::string &key = fields_[i].key;
+      size_t dot = key.rfind('.');
+      auto table = dot == std::string::npos ? tables_.end() : tables_.find(key.substr(0, dot));
+
+      TomlParser::Position unknown = { -1, -1, TomlError::npos };
+      parser_.error_at(TomlErrorCode::MissingKey, table != tables_.end() ? table->second : unknown, key);
+   }
+}
@@ -0,0 +1,47 @@
+#include "include/tomlshared.h"
+
+using namespace ctoml;
+
+TomlSharedDocument::TomlSharedDocument() : current_(std::make_shared<const TomlDocument>()), version_(0) { }
+
+TomlSharedDocument::TomlSharedDocument(TomlDocument doc) :
+   current_(std::make_shared<const TomlDocument>(std::move(doc))), version_(0) { }
+
+std::shared_ptr<const TomlDocument> TomlSharedDocument::snapshot() const {
+   return std::atomic_load(&current_);
+}
+
+void TomlSharedDocument::publish(TomlDocument doc) {
+   std::shared_ptr<const TomlDocument> next = std::make_shared<const TomlDocument>(std::move(doc));
+
+   std::lock_guard<std::mutex> lock(write_mutex_);
+   std::atomic_store(&current_, next);
+   version_.fetch_add(1, std::memory_order_release);
+}
+
+void TomlSharedDocument::update(const std::function<void(TomlDocument &)> &change) {
+   std::lock_guard<std::mutex> lock(write_mutex_);
+
+   std::shared_ptr<TomlDocument> next = std::make_shared<TomlDocument>(*std::atomic_load(&current_));
+   change(*next);
+
+   std::atomic_store(&current_, std::shared_ptr<const TomlDocument>(next));
+   version_.fetch_add(1, std::memory_order_release);
+}
+
+bool TomlSharedDocument::set(const std::string &key, std::shared_ptr<TomlValue> value) {
+   bool result = false;
+   update([&](TomlDocument &doc) { result = doc.set(key, value); });
+   return result;
+}
+
+TomlSharedDocument::Reader::Reader(const TomlSharedDocument &shared) : shared_(&shared), version_(0) {
+   refresh();
+}
+
+void TomlSharedDocument::Reader::refresh() {
+   // Read the version first: if a writer publishes in between, the snapshot is
+   // newer than the version and the next get() just refreshes again
+   version_ = shared_->version_.load(std::memory_order_acquire);
+   snapshot_ = shared_->snapshot();
+}
@@ -0,0 +1,345 @@
+#include "include/tomlsnapshot.h"
+#include "include/tomlscan.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace ctoml;
+
+static const char kMagic[8] = { 'C', 'T', 'O', 'M', 'L', 'S', 'N', 'P' };
+
+// Written in the machine's byte order; reads back differently on another one
+static const std::uint32_t kByteOrderMark = 0x01020304;
+
+// The image starts with a header, followed by the keys, the key index, the values
+// and a pool holding key names and string contents. The first num_keys values
+// belong to the keys in order; the elements of each array follow, in blocks.
+struct TomlSnapshot::Header {
+   char magic[8];
+   std::uint32_t version;
+   std::uint32_t byte_order;
+   std::uint64_t file_size;
+
+   // The TOML text the snapshot was made from
+   std::uint64_t source_size;
+   std::uint64_t source_hash;
+
+   std::uint64_t num_keys;
+   std::uint64_t num_values;
+   std::uint64_t strings_size;
+
+   // Where each section starts, from the start of the file
+   std::uint64_t keys_offset;
+   std::uint64_t index_offset;
+   std::uint64_t values_offset;
+   std::uint64_t strings_offset;
+};
+
+struct TomlSnapshot::Key {
+   std::uint64_t hash; // TomlTable::hash of the name
+   std::uint64_t name_offset; // Into the string pool
+   std::uint64_t name_size;
+};
+
+// Rounds n up to a multiple of 16, so every section is aligned for its contents
+static std::uint64_t align16(std::uint64_t n) {
+   return (n + 15) & ~static_cast<std::uint64_t>(15);
+}
+
+TomlSnapshot::TomlSnapshot() : header_(nullptr), keys_(nullptr), index_(nullptr), values_(nullptr),
+   strings_(nullptr) { }
+
+bool TomlSnapshot::save(const TomlDocument &doc, const std::string &source, const std::string &filename) {
+   return save(doc, source.data(), source.size(), filename);
+}
+
+bool TomlSnapshot::save(const TomlDocument &doc, const char *source, size_t size, const std::string &filename) {
+   std::vector<TomlSnapshotValue> values(doc.size());
+   std::vector<Key> keys(doc.size());
+   std::string strings;
+
+   size_t i = 0;
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it, ++i) {
+      keys[i].hash = TomlTable::hash(it->first.data(), it->first.size());
+      keys[i].name_offset = strings.size();
+      keys[i].name_size = it->first.size();
+      strings += it->first;
+   }
+
+   // Encode breadth first, so the keys' values come first and each array's
+   // elements are a block after it. Strings and arrays hold the position of
+   // their contents until the sections are placed.
+   std::vector<const TomlValue *> pending;
+   pending.reserve(doc.size());
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) pending.push_back(it->second.get());
+
+   for (size_t v = 0; v < pending.size(); v++) {
+      // Unboxed array elements were encoded along with their array
+      if (!pending[v]) continue;
+
+      const TomlValue &value = *pending[v];
+      TomlSnapshotValue &out = values[v];
+      out.type_ = static_cast<std::uint8_t>(value.type());
+
+      switch (value.type()) {
+         case TomlType::Int:
+            out.int_ = static_cast<const TomlInt &>(value).value();
+            break;
+         case TomlType::Float:
+            out.float_ = static_cast<const TomlFloat &>(value).value();
+            break;
+         case TomlType::Boolean:
+            out.boolean_ = static_cast<const TomlBoolean &>(value).value();
+            break;
+         case TomlType::DateTime:
+            out.datetime_ = static_cast<const TomlDateTime &>(value).value();
+            break;
+         case TomlType::String: {
+            const TomlString &str = static_cast<const TomlString &>(value);
+            out.size_ = static_cast<std::uint32_t>(str.size());
+            out.offset_ = static_cast<std::int64_t>(strings.size());
+            strings.append(str.data(), str.size());
+            break;
+         }
+         case TomlType::Array: {
+            const TomlArray &array = static_cast<const TomlArray &>(value);
+            size_t first = pending.size();
+            out.size_ = static_cast<std::uint32_t>(array.size());
+            out.offset_ = static_cast<std::int64_t>(first);
+
+            bool unboxed = !array.int_span().empty() || !array.float_span().empty() || !array.bool_span().empty();
+            for (size_t k = 0; k < array.size(); k++) {
+               pending.push_back(unboxed ? nullptr : array.at(static_cast<int>(k)).get());
+            }
+            values.resize(pending.size(), TomlSnapshotValue());
+
+            // Out is invalid from here on, as values may have moved
+            for (size_t k = 0; k < array.int_span().size(); k++) {
+               values[first + k].type_ = static_cast<std::uint8_t>(TomlType::Int);
+               values[first + k].int_ = array.int_span()[k];
+            }
+            for (size_t k = 0; k < array.float_span().size(); k++) {
+               values[first + k].type_ = static_cast<std::uint8_t>(TomlType::Float);
+               values[first + k].float_ = array.float_span()[k];
+            }
+            for (size_t k = 0; k < array.bool_span().size(); k++) {
+               values[first + k].type_ = static_cast<std::uint8_t>(TomlType::Boolean);
+               values[first + k].boolean_ = array.bool_span()[k];
+            }
+            break;
+         }
+      }
+   }
+
+   std::vector<std::uint32_t> index(doc.size());
+   for (size_t k = 0; k < index.size(); k++) index[k] = static_cast<std::uint32_t>(k);
+   std::sort(index.begin(), index.end(), [&keys](std::uint32_t a, std::uint32_t b) {
+      return keys[a].hash < keys[b].hash;
+   });
+
+   Header header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, kMagic, sizeof(kMagic));
+   header.version = kVersion;
+   header.byte_order = kByteOrderMark;
+   header.source_size = size;
+   header.source_hash = toml_hash_bytes(source, size);
+   header.num_keys = keys.size();
+   header.num_values = values.size();
+   header.strings_size = strings.size();
+   header.keys_offset = align16(sizeof(Header));
+   header.index_offset = align16(header.keys_offset + keys.size() * sizeof(Key));
+   header.values_offset = align16(header.index_offset + index.size() * sizeof(std::uint32_t));
+   header.strings_offset = header.values_offset + values.size() * sizeof(TomlSnapshotValue);
+   header.file_size = header.strings_offset + strings.size();
+
+   // Turn positions into offsets from each value
+   for (size_t v = 0; v < values.size(); v++) {
+      std::int64_t self = static_cast<std::int64_t>(header.values_offset + v * sizeof(TomlSnapshotValue));
+      TomlSnapshotValue &value = values[v];
+
+      if (value.type() == TomlType::String) {
+         value.offset_ = static_cast<std::int64_t>(header.strings_offset) + value.offset_ - self;
+      } else if (value.type() == TomlType::Array) {
+         value.offset_ = static_cast<std::int64_t>(header.values_offset) +
+            value.offset_ * static_cast<std::int64_t>(sizeof(TomlSnapshotValue)) - self;
+      }
+   }
+
+   std::string image(header.file_size, '\0');
+   memcpy(&image[0], &header, sizeof(header));
+   if (!keys.empty()) memcpy(&image[header.keys_offset], keys.data(), keys.size() * sizeof(Key));
+   if (!index.empty()) memcpy(&image[header.index_offset], index.data(), index.size() * sizeof(std::uint32_t));
+   if (!values.empty()) memcpy(&image[header.values_offset], values.data(), values.size() * sizeof(TomlSnapshotValue));
+   if (!strings.empty()) memcpy(&image[header.strings_offset], strings.data(), strings.size());
+
+   std::string temp = filename + ".tmp";
+   {
+      std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+      out.write(image.data(), image.size());
+      if (!out.good()) {
+         std::remove(temp.c_str());
+         return false;
+      }
+   }
+
+   if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+      // Windows will not rename over an existing file
+      std::remove(filename.c_str());
+      if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+         std::remove(temp.c_str());
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool TomlSnapshot::open(const std::string &filename, const std::string &source) {
+   return open(filename, source.data(), source.size());
+}
+
+bool TomlSnapshot::open(const std::string &filename, const char *source, size_t size) {
+   close();
+
+   std::shared_ptr<TomlMappedFile> file = std::make_shared<TomlMappedFile>();
+   if (!file->open(filename) || file->size() < sizeof(Header)) return false;
+
+   const Header *header = reinterpret_cast<const Header *>(file->data());
+   if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+      header->byte_order != kByteOrderMark || header->file_size != file->size()) return false;
+
+   // Reject snapshots of any other text
+   if (header->source_size != size || header->source_hash != toml_hash_bytes(source, size)) return false;
+
+   file_ = file;
+   header_ = header;
+   if (!validate()) {
+      close();
+      return false;
+   }
+
+   return true;
+}
+
+bool TomlSnapshot::validate() {
+   const Header &h = *header_;
+   const std::uint64_t file_size = h.file_size;
+
+   // Each section must fit, in order, and be aligned for its contents
+   if (h.keys_offset < sizeof(Header) || h.keys_offset % 16 || h.index_offset % 16 || h.values_offset % 16) return false;
+   if (h.num_keys > h.num_values || h.num_values > file_size / sizeof(TomlSnapshotValue)) return false;
+   if (h.index_offset < h.keys_offset + h.num_keys * sizeof(Key) ||
+      h.values_offset < h.index_offset + h.num_keys * sizeof(std::uint32_t) ||
+      h.strings_offset < h.values_offset + h.num_values * sizeof(TomlSnapshotValue) ||
+      h.strings_offset > file_size || h.strings_size != file_size - h.strings_offset) return false;
+
+   const char *base = file_->data();
+   keys_ = reinterpret_cast<const Key *>(base + h.keys_offset);
+   index_ = reinterpret_cast<const std::uint32_t *>(base + h.index_offset);
+   values_ = reinterpret_cast<const TomlSnapshotValue *>(base + h.values_offset);
+   strings_ = base + h.strings_offset;
+
+   for (std::uint64_t k = 0; k < h.num_keys; k++) {
+      if (index_[k] >= h.num_keys) return false;
+      if (keys_[k].name_offset > h.strings_size || keys_[k].name_size > h.strings_size - keys_[k].name_offset) {
+         return false;
+      }
+   }
+
+   for (std::uint64_t v = 0; v < h.num_values; v++) {
+      const TomlSnapshotValue &value = values_[v];
+      if (value.type_ > static_cast<std::uint8_t>(TomlType::Array)) return false;
+
+      std::int64_t target = static_cast<std::int64_t>(h.values_offset + v * sizeof(TomlSnapshotValue)) + value.offset_;
+      if (value.type() == TomlType::String) {
+         std::int64_t start = static_cast<std::int64_t>(h.strings_offset);
+         if (target < start || target + value.size_ > static_cast<std::int64_t>(file_size)) return false;
+      } else if (value.type() == TomlType::Array) {
+         // Elements always come after their array, which also rules out cycles
+         std::int64_t first = target - static_cast<std::int64_t>(h.values_offset);
+         if (first % static_cast<std::int64_t>(sizeof(TomlSnapshotValue))) return false;
+         first /= static_cast<std::int64_t>(sizeof(TomlSnapshotValue));
+         if (first <= static_cast<std::int64_t>(v) ||
+            first + value.size_ > static_cast<std::int64_t>(h.num_values)) return false;
+      }
+   }
+
+   return true;
+}
+
+void TomlSnapshot::close() {
+   file_.reset();
+   header_ = nullptr;
+   keys_ = nullptr;
+   index_ = nullptr;
+   values_ = nullptr;
+   strings_ = nullptr;
+}
+
+size_t TomlSnapshot::size() const {
+   return header_ ? static_cast<size_t>(header_->num_keys) : 0;
+}
+
+std::string TomlSnapshot::key(size_t i) const {
+   return std::string(strings_ + keys_[i].name_offset, static_cast<size_t>(keys_[i].name_size));
+}
+
+const TomlSnapshotValue &TomlSnapshot::value(size_t i) const {
+   return values_[i];
+}
+
+const TomlSnapshotValue *TomlSnapshot::get(const char *key, size_t len) const {
+   if (!header_) return nullptr;
+
+   std::uint64_t hash = TomlTable::hash(key, len);
+   const std::uint32_t *end = index_ + header_->num_keys;
+   const std::uint32_t *it = std::lower_bound(index_, end, hash, [this](std::uint32_t k, std::uint64_t h) {
+      return keys_[k].hash < h;
+   });
+
+   for (; it != end && keys_[*it].hash == hash; ++it) {
+      const Key &k = keys_[*it];
+      if (k.name_size == len && memcmp(strings_ + k.name_offset, key, len) == 0) return &values_[*it];
+   }
+
+   return nullptr;
+}
+
+std::shared_ptr<TomlValue> TomlSnapshot::make_value(TomlArena &arena, const TomlSnapshotValue &value) const {
+   switch (value.type()) {
+      case TomlType::Int: return arena.make_value<TomlInt>(value.int_value());
+      case TomlType::Float: return arena.make_value<TomlFloat>(value.float_value());
+      case TomlType::Boolean: return arena.make_value<TomlBoolean>(value.bool_value());
+      case TomlType::DateTime: return arena.make_value<TomlDateTime>(value.datetime_value());
+      case TomlType::String: return arena.make_value<TomlString>(value.string_data(), value.size(), &arena);
+      case TomlType::Array: {
+         std::shared_ptr<TomlValue> array = arena.make_value<TomlArray>(&arena);
+         TomlArray &elements = static_cast<TomlArray &>(*array);
+         for (auto &element : value) {
+            switch (element.type()) {
+               case TomlType::Int: elements.add_int(element.int_value()); break;
+               case TomlType::Float: elements.add_float(element.float_value()); break;
+               case TomlType::Boolean: elements.add_boolean(element.bool_value()); break;
+               default: elements.add(make_value(arena, element)); break;
+            }
+         }
+         return array;
+      }
+   }
+
+   return nullptr;
+}
+
+TomlDocument TomlSnapshot::to_document() const {
+   std::shared_ptr<TomlArena> arena = std::make_shared<TomlArena>();
+   TomlDocument doc(arena);
+
+   for (size_t i = 0; i < size(); i++) {
+      doc.insert(key(i), make_value(*arena, values_[i]));
+   }
+
+   return doc;
+}
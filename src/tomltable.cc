@@ -0,0 +1,98 @@
+#include "include/tomltable.h"
+
+#include <cstring>
+
+using namespace ctoml;
+
+// Tables up to this size are searched without a hash index
+static const size_t kLinearScanSize = 8;
+
+TomlTable::TomlTable(const TomlTable &other) : buckets_(other.buckets_) {
+   entries_.reserve(other.entries_.size());
+   for (auto &entry : other.entries_) {
+      Entry copy;
+      copy.name = entry.name;
+      copy.slot = entry.slot;
+      if (entry.table) copy.table.reset(new TomlTable(*entry.table));
+      entries_.push_back(std::move(copy));
+   }
+}
+
+TomlTable &TomlTable::operator=(const TomlTable &other) {
+   if (this != &other) {
+      TomlTable copy(other);
+      entries_.swap(copy.entries_);
+      buckets_.swap(copy.buckets_);
+   }
+
+   return *this;
+}
+
+std::uint64_t TomlTable::hash(const char *str, size_t len) {
+   std::uint64_t h = 14695981039346656037ULL;
+   for (size_t i = 0; i < len; i++) {
+      h = (h ^ static_cast<unsigned char>(str[i])) * 1099511628211ULL;
+   }
+
+   return h;
+}
+
+void TomlTable::rehash(size_t num_buckets) {
+   buckets_.assign(num_buckets, 0);
+
+   for (size_t i = 0; i < entries_.size(); i++) {
+      size_t b = hash(entries_[i].name.data(), entries_[i].name.size()) & (num_buckets - 1);
+      while (buckets_[b]) b = (b + 1) & (num_buckets - 1);
+      buckets_[b] = static_cast<std::uint32_t>(i + 1);
+   }
+}
+
+size_t TomlTable::find_index(const char *name, size_t len) const {
+   if (buckets_.empty()) {
+      for (size_t i = 0; i < entries_.size(); i++) {
+         const std::string &n = entries_[i].name;
+         if (n.size() == len && memcmp(n.data(), name, len) == 0) return i;
+      }
+
+      return npos;
+   }
+
+   size_t mask = buckets_.size() - 1;
+   for (size_t b = hash(name, len) & mask; buckets_[b]; b = (b + 1) & mask) {
+      const std::string &n = entries_[buckets_[b] - 1].name;
+      if (n.size() == len && memcmp(n.data(), name, len) == 0) return buckets_[b] - 1;
+   }
+
+   return npos;
+}
+
+const TomlTable::Entry *TomlTable::find(const char *name, size_t len) const {
+   size_t i = find_index(name, len);
+   return i != npos ? &entries_[i] : nullptr;
+}
+
+TomlTable::Entry *TomlTable::find(const char *name, size_t len) {
+   size_t i = find_index(name, len);
+   return i != npos ? &entries_[i] : nullptr;
+}
+
+TomlTable::Entry &TomlTable::add(const char *name, size_t len) {
+   entries_.push_back(Entry());
+   Entry &entry = entries_.back();
+   entry.name.assign(name, len);
+   entry.slot = npos;
+
+   if (entries_.size() > kLinearScanSize) {
+      // Keep the load factor at or below one half
+      if (entries_.size() * 2 > buckets_.size()) {
+         rehash(buckets_.empty() ? kLinearScanSize * 4 : buckets_.size() * 2);
+      } else {
+         size_t mask = buckets_.size() - 1;
+         size_t b = hash(name, len) & mask;
+         while (buckets_[b]) b = (b + 1) & mask;
+         buckets_[b] = static_cast<std::uint32_t>(entries_.size());
+      }
+   }
+
+   return entry;
+}
@@ -0,0 +1,35 @@
+#include "include/tomlthread.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ctoml;
+
+unsigned ctoml::toml_default_threads() {
+   unsigned n = std::thread::hardware_concurrency();
+   return n ? n : 1;
+}
+
+void ctoml::toml_parallel_for(size_t count, unsigned num_threads, const std::function<void(size_t)> &task) {
+   if (num_threads == 0) num_threads = toml_default_threads();
+   if (num_threads > count) num_threads = static_cast<unsigned>(count);
+
+   std::atomic<size_t> next(0);
+   auto worker = [&]() {
+      for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; ) {
+         task(i);
+      }
+   };
+
+   std::vector<std::thread> threads;
+   for (unsigned i = 1; i < num_threads; i++) {
+      threads.push_back(std::thread(worker));
+   }
+
+   worker();
+
+   for (auto &thread : threads) {
+      thread.join();
+   }
+}
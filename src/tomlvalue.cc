@@ -1,4 +1,6 @@
 #include "include/tomlvalue.h"
+#include "include/tomlarena.h"
+#include "include/tomldatetime.h"
 
 using namespace ctoml;
 
@@ -28,6 +30,10 @@ std::unique_ptr<TomlValue> TomlValue::create_datetime(tm val) {
    return std::unique_ptr<TomlValue>(new TomlDateTime(val));
 }
 
+std::unique_ptr<TomlValue> TomlValue::create_datetime(time_t val) {
+   return std::unique_ptr<TomlValue>(new TomlDateTime(val));
+}
+
 std::unique_ptr<TomlValue> TomlValue::create_array() {
    return std::unique_ptr<TomlValue>(new TomlArray());
 }
@@ -56,37 +62,149 @@ bool TomlValue::equals(bool) const {
    return type() == TomlType::Boolean;
 }
 
-TomlString::TomlString(std::string val) : TomlValue(TomlType::String), val_(val) { }
+TomlString::TomlString(std::string val) : TomlValue(TomlType::String), val_(val.data(), val.size()) { }
+TomlString::TomlString(const char *str, size_t len, TomlMemoryResource *resource) :
+   TomlValue(TomlType::String), val_(str, len, TomlAllocator<char>(resource)) { }
 TomlInt::TomlInt(std::int64_t val) : TomlValue(TomlType::Int), val_(val) { }
 TomlFloat::TomlFloat(double val) : TomlValue(TomlType::Float), val_(val) { }
 TomlBoolean::TomlBoolean(bool val) : TomlValue(TomlType::Boolean), val_(val) { }
-TomlDateTime::TomlDateTime(tm val) : TomlValue(TomlType::DateTime) { val_ = mktime(&val); }
-TomlArray::TomlArray() : TomlValue(TomlType::Array) { }
+TomlDateTime::TomlDateTime(tm val) : TomlValue(TomlType::DateTime), val_(toml_time_from_tm(val)) { }
+TomlDateTime::TomlDateTime(time_t val) : TomlValue(TomlType::DateTime), val_(val) { }
+TomlArray::TomlArray(TomlMemoryResource *resource) : TomlValue(TomlType::Array), storage_(Storage::Values),
+   array_(resource), ints_(resource), floats_(resource), booleans_(resource) { }
 
-std::string TomlString::value() const { return val_; }
+std::string TomlString::value() const { return std::string(val_.data(), val_.size()); }
 std::int64_t TomlInt::value() const { return val_; }
 double TomlFloat::value() const { return val_; }
 bool TomlBoolean::value() const { return val_; }
 time_t TomlDateTime::value() const { return val_; }
 
+std::shared_ptr<TomlValue> TomlArray::hold(std::shared_ptr<TomlValue> v) const {
+   if (!arena_.owner_before(v) && !v.owner_before(arena_)) {
+      return std::shared_ptr<TomlValue>(std::shared_ptr<TomlValue>(), v.get());
+   }
+
+   return v;
+}
+
+void TomlArray::box() {
+   switch (storage_) {
+      case Storage::Ints:
+         for (auto value : ints_) array_.push_back(make_element<TomlInt>(value));
+         ints_ = Vector<std::int64_t>(resource());
+         break;
+      case Storage::Floats:
+         for (auto value : floats_) array_.push_back(make_element<TomlFloat>(value));
+         floats_ = Vector<double>(resource());
+         break;
+      case Storage::Booleans:
+         for (auto value : booleans_) array_.push_back(make_element<TomlBoolean>(value != 0));
+         booleans_ = Vector<std::uint8_t>(resource());
+         break;
+      case Storage::Values:
+         break;
+   }
+
+   storage_ = Storage::Values;
+}
+
 void TomlArray::add(std::unique_ptr<TomlValue> v) {
-   array_.push_back(move(v));
+   add(std::shared_ptr<TomlValue>(move(v)));
 }
 
 void TomlArray::add(std::shared_ptr<TomlValue> v) {
-   array_.push_back(v);
+   switch (v->type()) {
+      case TomlType::Int: return add_int(static_cast<const TomlInt &>(*v).value());
+      case TomlType::Float: return add_float(static_cast<const TomlFloat &>(*v).value());
+      case TomlType::Boolean: return add_boolean(static_cast<const TomlBoolean &>(*v).value());
+      default: break;
+   }
+
+   box();
+   array_.push_back(hold(v));
+}
+
+void TomlArray::add_int(std::int64_t value) {
+   if (size() == 0) storage_ = Storage::Ints;
+
+   if (storage_ == Storage::Ints) {
+      ints_.push_back(value);
+   } else {
+      box();
+      array_.push_back(make_element<TomlInt>(value));
+   }
+}
+
+void TomlArray::add_float(double value) {
+   if (size() == 0) storage_ = Storage::Floats;
+
+   if (storage_ == Storage::Floats) {
+      floats_.push_back(value);
+   } else {
+      box();
+      array_.push_back(make_element<TomlFloat>(value));
+   }
+}
+
+void TomlArray::add_boolean(bool value) {
+   if (size() == 0) storage_ = Storage::Booleans;
+
+   if (storage_ == Storage::Booleans) {
+      booleans_.push_back(value);
+   } else {
+      box();
+      array_.push_back(make_element<TomlBoolean>(value));
+   }
 }
 
 TomlArray::const_iterator TomlArray::cbegin() const {
-   return array_.cbegin();
+   return const_iterator(this, 0);
 }
 
 TomlArray::const_iterator TomlArray::cend() const {
-   return array_.cend();
+   return const_iterator(this, size());
+}
+
+TomlSpan<const std::int64_t> TomlArray::int_span() const {
+   if (storage_ != Storage::Ints) return TomlSpan<const std::int64_t>();
+   return TomlSpan<const std::int64_t>(ints_.data(), ints_.size());
+}
+
+TomlSpan<const double> TomlArray::float_span() const {
+   if (storage_ != Storage::Floats) return TomlSpan<const double>();
+   return TomlSpan<const double>(floats_.data(), floats_.size());
+}
+
+TomlSpan<const std::uint8_t> TomlArray::bool_span() const {
+   if (storage_ != Storage::Booleans) return TomlSpan<const std::uint8_t>();
+   return TomlSpan<const std::uint8_t>(booleans_.data(), booleans_.size());
+}
+
+size_t TomlArray::size() const {
+   switch (storage_) {
+      case Storage::Ints: return ints_.size();
+      case Storage::Floats: return floats_.size();
+      case Storage::Booleans: return booleans_.size();
+      case Storage::Values: break;
+   }
+
+   return array_.size();
 }
 
 std::shared_ptr<TomlValue> TomlArray::at(const int index) const {
-   return array_[index];
+   switch (storage_) {
+      // Boxed on the heap, as the array's resource may be an arena or not thread safe
+      case Storage::Ints: return std::make_shared<TomlInt>(ints_[index]);
+      case Storage::Floats: return std::make_shared<TomlFloat>(floats_[index]);
+      case Storage::Booleans: return std::make_shared<TomlBoolean>(booleans_[index] != 0);
+      case Storage::Values: break;
+   }
+
+   // Elements held without a reference take one on their arena again
+   const std::shared_ptr<TomlValue> &value = array_[index];
+   if (value && value.use_count() == 0) return std::shared_ptr<TomlValue>(arena_.lock(), value.get());
+
+   return value;
 }
 
 std::shared_ptr<TomlValue> TomlArray::operator[] (const int index) const {
@@ -94,11 +212,11 @@ std::shared_ptr<TomlValue> TomlArray::operator[] (const int index) const {
 }
 
 bool TomlString::equals(std::string val) const {
-   return val_ == val;
+   return val_.compare(0, val_.size(), val.data(), val.size()) == 0;
 }
 
 bool TomlString::equals(const char *val) const {
-   return val_ == std::string(val);
+   return val_.compare(val) == 0;
 }
 
 bool TomlInt::equals(std::int64_t val) const {
@@ -118,7 +236,7 @@ bool TomlBoolean::equals(bool val) const {
 }
 
 std::string TomlString::to_string() const {
-   return val_;
+   return value();
 }
 
 std::string TomlInt::to_string() const {
@@ -134,16 +252,21 @@ std::string TomlBoolean::to_string() const {
 }
 
 std::string TomlDateTime::to_string() const {
-   char buf[CTOML_MAX_DATE_LEN];
-   strftime(buf, CTOML_MAX_DATE_LEN, "%Y-%m-%dT%H:%M:%SZ", gmtime(&val_));
-   return std::string(buf);
+   char buf[kTomlDateTimeLength + 1];
+   return std::string(buf, toml_format_datetime(val_, buf));
 }
 
 std::string TomlArray::to_string() const {
    std::string str = "[";
-   for (int i = 0; i < (int)array_.size(); i++) {
+   for (size_t i = 0; i < size(); i++) {
       if (i) str += ", ";
-      str += array_[i]->to_string();
+
+      switch (storage_) {
+         case Storage::Ints: str += std::to_string(ints_[i]); break;
+         case Storage::Floats: str += std::to_string(floats_[i]); break;
+         case Storage::Booleans: str += booleans_[i] ? "true" : "false"; break;
+         case Storage::Values: str += array_[i]->to_string(); break;
+      }
    }
    str += "]";
 
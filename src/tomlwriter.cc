@@ -0,0 +1,250 @@
+#include "include/tomlwriter.h"
+#include "include/tomldatetime.h"
+#include "include/tomlnumber.h"
+#include "include/tomlscan.h"
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace ctoml;
+
+// Compares two names lexicographically, like std::string::compare
+static int compare_names(const char *a, size_t a_size, const char *b, size_t b_size) {
+   int c = memcmp(a, b, std::min(a_size, b_size));
+   return c ? c : (a_size > b_size) - (a_size < b_size);
+}
+
+const std::string &TomlWriter::write(const TomlDocument &doc) {
+   buffer_.clear();
+
+   items_.clear();
+   items_.reserve(doc.size());
+   groups_.clear();
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) {
+      size_t dot = it->first.rfind('.');
+      Item item = { it->first.data(), static_cast<std::uint32_t>(it->first.size()),
+         static_cast<std::uint32_t>(dot == std::string::npos ? 0 : dot), 0, it->second.get() };
+
+      // Keys of a group are usually together, so only compare with the previous one
+      if (groups_.empty() || groups_.back().size != item.group_size ||
+         memcmp(groups_.back().name, item.key, item.group_size) != 0) {
+         Group group = { item.key, item.group_size, 0 };
+         groups_.push_back(group);
+      }
+
+      item.group = static_cast<std::uint32_t>(groups_.size() - 1);
+      items_.push_back(item);
+   }
+
+   // Rank the groups by name, with root keys (the empty group) first. A group
+   // split into several runs gets the same rank for each.
+   order_.resize(groups_.size());
+   for (size_t i = 0; i < order_.size(); i++) order_[i] = static_cast<std::uint32_t>(i);
+   std::sort(order_.begin(), order_.end(), [this](std::uint32_t a, std::uint32_t b) {
+      return compare_names(groups_[a].name, groups_[a].size, groups_[b].name, groups_[b].size) < 0;
+   });
+
+   for (size_t i = 0, rank = 0; i < order_.size(); i++) {
+      const Group &group = groups_[order_[i]];
+      if (i && compare_names(groups_[order_[i - 1]].name, groups_[order_[i - 1]].size,
+         group.name, group.size) != 0) rank++;
+      groups_[order_[i]].rank = static_cast<std::uint32_t>(rank);
+   }
+
+   for (auto &item : items_) item.group = groups_[item.group].rank;
+
+   // Sort by group, then key, comparing the keys in place
+   std::sort(items_.begin(), items_.end(), [](const Item &a, const Item &b) {
+      if (a.group != b.group) return a.group < b.group;
+      return compare_names(a.key + a.group_size, a.size - a.group_size,
+         b.key + b.group_size, b.size - b.group_size) < 0;
+   });
+
+   const Item *group = nullptr;
+   for (auto &item : items_) {
+      // Start a new key group when it changes
+      if (item.group_size && (!group || group->group != item.group)) {
+         buffer_ += '[';
+         buffer_.append(item.key, item.group_size);
+         buffer_ += "]\n";
+         group = &item;
+      }
+
+      // Keys in a group are written without the group's name and its '.'
+      size_t name_pos = item.group_size ? item.group_size + 1 : 0;
+      buffer_.append(item.key + name_pos, item.size - name_pos);
+      buffer_ += " = ";
+      append_value(*item.value);
+      buffer_ += '\n';
+   }
+
+   return buffer_;
+}
+
+std::ostream &TomlWriter::write(const TomlDocument &doc, std::ostream &out) {
+   write(doc);
+   return out.write(buffer_.data(), buffer_.size());
+}
+
+void TomlWriter::append_value(const TomlValue &value) {
+   switch (value.type()) {
+      case TomlType::String:
+         append_string(static_cast<const TomlString &>(value).data(), static_cast<const TomlString &>(value).size());
+         break;
+      case TomlType::Int:
+         append_int(static_cast<const TomlInt &>(value).value());
+         break;
+      case TomlType::Float:
+         append_float(static_cast<const TomlFloat &>(value).value());
+         break;
+      case TomlType::Boolean:
+         buffer_ += static_cast<const TomlBoolean &>(value).value() ? "true" : "false";
+         break;
+      case TomlType::DateTime: {
+         char buf[kTomlDateTimeLength + 1];
+         buffer_.append(buf, toml_format_datetime(static_cast<const TomlDateTime &>(value).value(), buf));
+         break;
+      }
+      case TomlType::Array: {
+         const TomlArray &array = static_cast<const TomlArray &>(value);
+         buffer_ += '[';
+
+         // Write unboxed elements straight from their storage
+         if (!array.int_span().empty()) {
+            for (size_t i = 0; i < array.size(); i++) {
+               if (i) buffer_ += ", ";
+               append_int(array.int_span()[i]);
+            }
+         } else if (!array.float_span().empty()) {
+            for (size_t i = 0; i < array.size(); i++) {
+               if (i) buffer_ += ", ";
+               append_float(array.float_span()[i]);
+            }
+         } else if (!array.bool_span().empty()) {
+            for (size_t i = 0; i < array.size(); i++) {
+               if (i) buffer_ += ", ";
+               buffer_ += array.bool_span()[i] ? "true" : "false";
+            }
+         } else {
+            for (auto it = array.cbegin(); it != array.cend(); ++it) {
+               if (it != array.cbegin()) buffer_ += ", ";
+               append_value(**it);
+            }
+         }
+
+         buffer_ += ']';
+         break;
+      }
+   }
+}
+
+void TomlWriter::append_string(const char *str, size_t len) {
+   buffer_ += '"';
+
+   // Copy runs of ordinary characters in one go
+   const char *run = str, *end = str + len;
+   for (const char *p; (p = toml_find_escapable(run, end)) != end; run = p + 1) {
+      buffer_.append(run, p);
+      buffer_ += '\\';
+      switch (*p) {
+         case '\n': buffer_ += 'n'; break;
+         case '\t': buffer_ += 't'; break;
+         case '\r': buffer_ += 'r'; break;
+         case '\b': buffer_ += 'b'; break;
+         case '\f': buffer_ += 'f'; break;
+         case '"': case '\\': buffer_ += *p; break;
+         default: {
+            // Other control characters have no short form
+            static const char kHex[] = "0123456789ABCDEF";
+            unsigned char c = static_cast<unsigned char>(*p);
+            char escape[] = { 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF] };
+            buffer_.append(escape, sizeof(escape));
+            break;
+         }
+      }
+   }
+
+   buffer_.append(run, end);
+   buffer_ += '"';
+}
+
+void TomlWriter::append_int(std::int64_t value) {
+   char buf[24];
+   char *p = buf + sizeof(buf);
+
+   // Work with the magnitude in unsigned arithmetic so INT64_MIN doesn't overflow
+   std::uint64_t n = value < 0 ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+   do {
+      *--p = static_cast<char>('0' + n % 10);
+      n /= 10;
+   } while (n);
+
+   if (value < 0) *--p = '-';
+   buffer_.append(p, buf + sizeof(buf));
+}
+
+void TomlWriter::append_float(double value) {
+   if (!std::isfinite(value)) {
+      // Not representable in TOML; write something recognisable
+      buffer_ += std::isnan(value) ? "nan" : value < 0 ? "-inf" : "inf";
+      return;
+   }
+
+   // Most floats are a short decimal m / 10^k, which is exactly how they are parsed
+   // back when m < 2^53, so try the fewest decimal places first.
+   double magnitude = fabs(value), scale = 1;
+   for (int decimals = 0; decimals <= 17; decimals++, scale *= 10) {
+      double m = std::round(magnitude * scale);
+      if (m > 9007199254740991.0) break;
+      if (m / scale != magnitude) continue;
+
+      // Write the digits backwards: the decimal places, then the whole part
+      char buf[24];
+      char *p = buf + sizeof(buf);
+      std::uint64_t n = static_cast<std::uint64_t>(m);
+      for (int i = 0; i < decimals; i++, n /= 10) *--p = static_cast<char>('0' + n % 10);
+      if (decimals == 0) *--p = '0';
+      *--p = '.';
+      do {
+         *--p = static_cast<char>('0' + n % 10);
+         n /= 10;
+      } while (n);
+
+      if (std::signbit(value)) *--p = '-';
+      buffer_.append(p, buf + sizeof(buf));
+      return;
+   }
+
+   // Otherwise use the fewest significant digits that read back as the same value. TOML
+   // floats have no exponent, so very large or small values are written in full.
+   char buf[400];
+   int len = 0;
+   for (int precision = 15; precision <= 17; precision++) {
+      len = snprintf(buf, sizeof(buf), "%.*g", precision, value);
+      if (memchr(buf, 'e', len)) {
+         // As many decimal places as the significant digits need
+         int exponent = static_cast<int>(floor(log10(fabs(value))));
+         int decimals = std::min(std::max(0, precision - 1 - exponent), 340);
+         len = snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+      }
+
+      // printf uses the C locale's decimal point
+      char point = *localeconv()->decimal_point;
+      char *dot = static_cast<char *>(memchr(buf, point, len));
+      if (dot) {
+         *dot = '.';
+
+         // Drop trailing zeros, keeping a digit after the point
+         while (buf[len - 1] == '0' && buf + len - 2 > dot) len--;
+      }
+
+      double parsed;
+      if (toml_parse_float(buf, buf + len, &parsed) == TomlNumberResult::Ok && parsed == value) break;
+   }
+
+   buffer_.append(buf, len);
+   if (!memchr(buf, '.', len)) buffer_ += ".0";
+}
@@ -1,10 +1,37 @@
 #include "../src/include/toml.h"
+#include "../src/include/tomlcompact.h"
+#include "../src/include/tomllazy.h"
+#include "../src/include/tomldiff.h"
+#include "../src/include/tomlshared.h"
+#include "../src/include/tomlwriter.h"
+#include "../src/include/tomlsnapshot.h"
+#include "../src/include/tomlschema.h"
+#include "../src/include/tomlscan.h"
+#include "../src/include/tomldatetime.h"
 
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <cstdio>
 #include <cassert>
+#include <thread>
+#include <mutex>
 
 using namespace ctoml;
 
+// Returns true if two documents hold the same keys and values in the same order
+bool same_document(const TomlDocument &a, const TomlDocument &b) {
+   if (a.size() != b.size()) return false;
+
+   for (auto i = a.cbegin(), j = b.cbegin(); i != a.cend(); ++i, ++j) {
+      if (i->first != j->first || i->second->to_string() != j->second->to_string()) return false;
+   }
+
+   return true;
+}
+
 // test_key_groups
 // Tests whether key groups are parsed correctly
 void test_key_groups() {
@@ -28,6 +55,875 @@ void test_parse_ints() {
    assert(doc.get_as<std::int64_t>("test-small-int") == -1152921504606846976LL);
 }
 
+// test_parse_numbers
+// Tests integer and float edge cases, including values that don't fit
+void test_parse_numbers() {
+   TomlParser toml;
+   auto doc = toml.parse_buffer(
+      "max = 9223372036854775807\n"
+      "min = -9223372036854775808\n"
+      "zero = -0\n"
+      "tenth = 0.1\n"
+      "pi = -3.14159265358979\n"
+      "small = 0.000000000000000000000000123\n"
+      "long = 1.2345678901234567890123456789\n"
+      "floats = [ 1.5, -2.25, 100.0 ]\n");
+
+   assert(toml.success());
+   assert(doc.get_as<std::int64_t>("max") == INT64_MAX);
+   assert(doc.get_as<std::int64_t>("min") == INT64_MIN);
+   assert(doc.get_as<std::int64_t>("zero") == 0);
+   assert(doc.get_as<double>("tenth") == 0.1);
+   assert(doc.get_as<double>("pi") == -3.14159265358979);
+   assert(doc.get_as<double>("small") == 0.000000000000000000000000123);
+   assert(doc.get_as<double>("long") == 1.2345678901234567890123456789);
+   assert(doc.get_array_as<double>("floats") == std::vector<double>({ 1.5, -2.25, 100.0 }));
+
+   // Integers that overflow are errors rather than being clamped or wrapped
+   const char *out_of_range[] = { "9223372036854775808", "-9223372036854775809", "99999999999999999999" };
+   for (const char *value : out_of_range) {
+      toml.parse_buffer(std::string("a = ") + value + " # comment\n");
+      assert(toml.num_errors() == 1);
+      assert(toml.get_error(0).message == "\"" + std::string(value) + "\" is out of range");
+   }
+
+   const char *invalid[] = { "-", "1.2.3", "12a", "-." };
+   for (const char *value : invalid) {
+      toml.parse_buffer(std::string("a = ") + value + " # comment\n");
+      assert(toml.num_errors() == 1);
+      assert(toml.get_error(0).message.find("not a valid value") != std::string::npos);
+   }
+}
+
+// test_parse_datetimes
+// Tests whether datetimes are read and written as UTC
+void test_parse_datetimes() {
+   TomlParser toml("tests.toml");
+   auto doc = toml.parse();
+
+   assert(doc.get_as<time_t>("test-date") == 296631120);
+   assert(doc.get("test-date")->to_string() == "1979-05-27T05:32:00Z");
+
+   auto parsed = toml.parse_buffer(
+      "before = 1969-12-31T23:59:59Z\n"
+      "leap = 2000-02-29T12:00:00Z\n"
+      "last = 9999-12-31T23:59:59Z\n");
+   assert(toml.success());
+   assert(parsed.get_as<time_t>("before") == -1);
+   assert(parsed.get_as<time_t>("leap") == 951825600);
+   assert(parsed.get("before")->to_string() == "1969-12-31T23:59:59Z");
+   assert(parsed.get("last")->to_string() == "9999-12-31T23:59:59Z");
+
+   // Fields out of range are not valid datetimes
+   const char *invalid[] = { "2001-02-29T00:00:00Z", "2001-13-01T00:00:00Z", "2001-01-01T24:00:00Z",
+      "2001-01-0aT00:00:00Z" };
+   for (const char *value : invalid) {
+      toml.parse_buffer(std::string("a = ") + value + " # comment\n");
+      assert(toml.num_errors() == 1);
+   }
+
+   // Formatting and parsing should round trip, a few hours into every day for a few centuries
+   char buf[kTomlDateTimeLength + 1];
+   for (time_t t = -5000000000LL; t < 10000000000LL; t += 86400 + 3599) {
+      time_t parsed_time;
+      assert(toml_format_datetime(t, buf) == kTomlDateTimeLength);
+      assert(toml_parse_datetime(buf, buf + kTomlDateTimeLength, &parsed_time));
+      assert(parsed_time == t);
+   }
+
+   // Broken down time is taken to be UTC, and normalised
+   tm date = tm();
+   date.tm_year = 79;
+   date.tm_mon = 4;
+   date.tm_mday = 27;
+   date.tm_hour = 5;
+   date.tm_min = 32;
+   assert(TomlDateTime(date).value() == 296631120);
+
+   date.tm_mon = 16; // May of the following year
+   date.tm_mday = 0; // The last day of April
+   assert(TomlDateTime(date).to_string() == "1980-04-30T05:32:00Z");
+}
+
+// Records parse events as text
+class EventRecorder : public TomlHandler {
+public:
+   std::string events;
+
+   void on_table_header(const char *name, size_t len) { events += "[" + std::string(name, len) + "] "; }
+   void on_key(const char *key, size_t len) { events += std::string(key, len) + "="; }
+   void on_string(const char *str, size_t len) { events += "s:" + std::string(str, len) + " "; }
+   void on_int(std::int64_t value) { events += "i:" + std::to_string(value) + " "; }
+   void on_float(double value) { events += "f:" + std::to_string(value) + " "; }
+   void on_boolean(bool value) { events += value ? "b:true " : "b:false "; }
+   void on_datetime(time_t value) { events += "d:" + std::to_string(value) + " "; }
+   void on_array_begin() { events += "( "; }
+   void on_array_end() { events += ") "; }
+};
+
+// test_parse_events
+// Tests whether documents can be parsed as a stream of events
+void test_parse_events() {
+   TomlParser toml;
+   EventRecorder recorder;
+   toml.parse_buffer(
+      "title = \"a \\\"quoted\\\" title\" # comment\n"
+      "[group.sub]\n"
+      "on = true\n"
+      "nested = [ [1, 2], [], [\"x\"] ]\n"
+      "pi = 3.5\n"
+      "when = 1970-01-02T00:00:00Z\n", recorder);
+
+   assert(toml.success());
+   assert(recorder.events == "title=s:a \"quoted\" title [group.sub] on=b:true "
+      "nested=( ( i:1 i:2 ) ( ) ( s:x ) ) pi=f:3.500000 when=d:86400 ");
+
+   // Errors are still collected, and values that fail produce no event
+   recorder.events.clear();
+   toml.parse_buffer("a = ? # bad\nb = 2\n", recorder);
+   assert(toml.num_errors() == 1);
+   assert(recorder.events == "a=b=i:2 ");
+
+   // Streaming parses of a file work the same way
+   TomlParser file("tests.toml");
+   recorder.events.clear();
+   file.parse(recorder);
+   assert(file.success());
+   assert(recorder.events.find("[group.subgroup] apples=s:apples ") != std::string::npos);
+}
+
+// test_parse_lazy
+// Tests whether lazily parsed documents decode values only when they are read
+void test_parse_lazy() {
+   TomlLazyDocument lazy;
+   {
+      TomlParser toml("tests.toml");
+      lazy = toml.parse_lazy();
+      assert(toml.success());
+   }
+
+   // The file stays mapped after the parser has gone
+   TomlParser eager("tests.toml");
+   auto doc = eager.parse();
+   assert(lazy.size() == doc.size());
+   assert(lazy.num_decoded() == 0);
+
+   assert(lazy.get_as<std::string>("test-string") == doc.get_as<std::string>("test-string"));
+   assert(lazy.get_as<std::int64_t>("test-small-int") == -1152921504606846976LL);
+   assert(lazy.get_as<std::string>("group.subgroup.apples") == "apples");
+   assert(lazy.num_decoded() == 3);
+
+   // Values are cached once decoded
+   assert(lazy.find("test-string") == lazy.find("test-string"));
+   assert(lazy.num_decoded() == 3);
+   assert(lazy.find("no-such-key") == nullptr);
+
+   // Every value matches a full parse
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) {
+      assert(lazy.get(it->first)->to_string() == it->second->to_string());
+   }
+   assert(lazy.num_decoded() == doc.size());
+
+   // Structural errors are found up front, but errors within values only when read
+   TomlParser toml;
+   std::string src = "a = [1, \"]\", [2, 3]] # done\nb = 1.2.3\nc = \"ok\"\n";
+   lazy = toml.parse_buffer_lazy(src.data(), src.size());
+   assert(toml.success());
+   assert(lazy.get("a")->to_string() == "[1, ], [2, 3]]");
+   assert(lazy.get("b") == nullptr);
+   assert(lazy.get_as<std::string>("c") == "ok");
+
+   src += "c = 2 # again\n";
+   toml.parse_buffer_lazy(src.data(), src.size());
+   assert(toml.num_errors() == 1);
+}
+
+// test_reparse
+// Tests whether reparsing a changed source reports the right changes and shares
+// unchanged values
+void test_reparse() {
+   std::string v1 =
+      "title = \"config\"\n"
+      "[server]\nhost = \"localhost\"\nport = 80\nports = [80, 443]\n"
+      "[client]\nretries = 3\ntimeout = 1.5\n"
+      "[old]\nkey = true\n";
+
+   TomlParser toml;
+   TomlDiff diff;
+   auto first = toml.reparse_buffer(TomlDocument(), v1.data(), v1.size(), diff);
+   assert(toml.success());
+   assert(diff.added.size() == first.size() && diff.removed.empty() && diff.changed.empty());
+
+   // Change a value, add a key and remove a section
+   std::string v2 =
+      "title = \"config\"\n"
+      "[server]\nhost = \"localhost\"\nport = 8080\nports = [80, 443]\n"
+      "[client]\nretries = 3\ntimeout = 1.5\n"
+      "[new]\nkey = \"added\"\n";
+
+   auto second = toml.reparse_buffer(first, v2.data(), v2.size(), diff);
+   assert(toml.success());
+   assert(same_document(second, toml.parse_buffer(v2)));
+   assert(diff.changed == std::vector<std::string>({ "server.port" }));
+   assert(diff.added == std::vector<std::string>({ "new.key" }));
+   assert(diff.removed == std::vector<std::string>({ "old.key" }));
+
+   // Unchanged values are shared, both in unchanged and changed sections
+   assert(second.find("client.timeout") == first.find("client.timeout"));
+   assert(second.find("title") == first.find("title"));
+   assert(second.find("server.ports") == first.find("server.ports"));
+   assert(second.find("server.port") != first.find("server.port"));
+
+   // Reparsing the same source changes nothing
+   auto third = toml.reparse_buffer(second, v2.data(), v2.size(), diff);
+   assert(diff.empty());
+   assert(third.find("new.key") == second.find("new.key"));
+
+   // Sections are compared by text, which the document keeps once the buffer is gone
+   TomlDocument copy;
+   {
+      std::string temp = v2;
+      copy = toml.reparse_buffer(third, temp.data(), temp.size(), diff);
+      temp.assign(temp.size(), '#');
+   }
+   auto again = toml.reparse_buffer(copy, v2.data(), v2.size(), diff);
+   assert(diff.empty());
+   assert(again.find("client.timeout") == first.find("client.timeout"));
+
+   // Modified documents are compared by value instead
+   third.set("client.retries", TomlValue::create_int(4));
+   auto fourth = toml.reparse_buffer(third, v2.data(), v2.size(), diff);
+   assert(diff.changed == std::vector<std::string>({ "client.retries" }));
+   assert(fourth.get_as<int>("client.retries") == 3);
+
+   // Errors in unchanged sections are still found
+   std::string dup = v2 + "[client]\nretries = 5 # again\n";
+   toml.reparse_buffer(fourth, dup.data(), dup.size(), diff);
+   assert(toml.num_errors() == 1);
+}
+
+// test_shared_document
+// Tests whether readers of a shared document see consistent versions while it is written
+void test_shared_document() {
+   TomlParser toml;
+   TomlSharedDocument shared(toml.parse_buffer("a = 0\nb = 0\n"));
+
+   // Writers keep a and b equal; readers should never see them differ
+   std::atomic<bool> done(false);
+   std::atomic<int> mismatches(0);
+   std::vector<std::thread> readers;
+   for (int i = 0; i < 4; i++) {
+      readers.push_back(std::thread([&] {
+         TomlSharedDocument::Reader reader(shared);
+         std::int64_t last = 0;
+         while (!done.load()) {
+            const TomlDocument &doc = reader.get();
+            std::int64_t a = doc.get_as<std::int64_t>("a"), b = doc.get_as<std::int64_t>("b");
+            if (a != b || a < last) mismatches++;
+            last = a;
+         }
+      }));
+   }
+
+   for (int i = 1; i <= 500; i++) {
+      shared.update([i](TomlDocument &doc) {
+         doc.set("a", TomlValue::create_int(i));
+         doc.set("b", TomlValue::create_int(i));
+      });
+   }
+
+   done = true;
+   for (auto &reader : readers) reader.join();
+   assert(mismatches == 0);
+   assert(shared.version() == 500);
+
+   // Snapshots are unaffected by later writes
+   auto before = shared.snapshot();
+   assert(shared.set("c", TomlValue::create_string("new")));
+   assert(!before->is_key("c"));
+   assert(shared.snapshot()->get_as<std::string>("c") == "new");
+
+   shared.publish(toml.parse_buffer("reloaded = true"));
+   TomlSharedDocument::Reader reader(shared);
+   assert(reader.get().get_as<bool>("reloaded"));
+   assert(before->get_as<int>("a") == 500);
+}
+
+// test_write
+// Tests whether written documents are sorted, escaped and read back the same
+void test_write() {
+   TomlParser toml;
+   auto doc = toml.parse_buffer(
+      "zeta = 1\n"
+      "[b]\nz = \"quote \\\" backslash \\\\ tab \\t newline \\n\"\n"
+      "[a.c]\nx = [[1, 2], [3]]\n"
+      "[a]\ny = 1979-05-27T07:32:00Z\nb = false\n"
+      "alpha = 0.1\n");
+   doc.set("a.big", TomlValue::create_float(1e20));
+   doc.set("a.small", TomlValue::create_float(-1.25e-7));
+   doc.set("a.min", TomlValue::create_int(INT64_MIN));
+
+   TomlWriter writer;
+   assert(writer.write(doc) ==
+      "zeta = 1\n"
+      "[a]\n"
+      "alpha = 0.1\n"
+      "b = false\n"
+      "big = 100000000000000000000.0\n"
+      "min = -9223372036854775808\n"
+      "small = -0.000000125\n"
+      "y = 1979-05-27T07:32:00Z\n"
+      "[a.c]\n"
+      "x = [[1, 2], [3]]\n"
+      "[b]\n"
+      "z = \"quote \\\" backslash \\\\ tab \\t newline \\n\"\n");
+
+   // Parsing the output gives the same document
+   auto reread = toml.parse_buffer(writer.buffer());
+   assert(toml.success());
+   assert(toml_diff(doc, reread).empty());
+
+   // As does writing to a stream
+   std::ostringstream out;
+   doc.write(out);
+   assert(out.str() == writer.buffer());
+
+   // Floats are written with as many digits as they need
+   const double floats[] = { 3.141592653589793, 1.0 / 3, 5e-324, 1.7976931348623157e308, 123456.789,
+      -0.0, 0.5, -2.0, 1e16, 9007199254740993.0, 0.000001, 2.2250738585072014e-308 };
+   for (double value : floats) {
+      TomlDocument single;
+      single.set("f", TomlValue::create_float(value));
+
+      auto parsed = toml.parse_buffer(writer.write(single));
+      assert(parsed.get_as<double>("f") == value);
+   }
+
+   // Every control character is escaped, and reads back as itself
+   std::string controls;
+   for (int c = 0; c < 0x20; c++) controls += "ab" + std::string(1, static_cast<char>(c));
+   controls += '\x7F';
+   TomlDocument escaped;
+   escaped.set("s", TomlValue::create_string(controls));
+   std::string written = writer.write(escaped);
+   assert(written.find("\\b") != std::string::npos && written.find("\\f") != std::string::npos);
+   assert(written.find("\\u0000") != std::string::npos && written.find("\\u001F") != std::string::npos);
+   assert(written.find("\\u007F") != std::string::npos);
+   for (char c : written) assert(c == '\n' || (static_cast<unsigned char>(c) >= 0x20 && c != 0x7F));
+
+   auto unescaped = toml.parse_buffer(written);
+   assert(toml.success());
+   assert(unescaped.get_as<std::string>("s") == controls);
+
+   // Unicode escapes read as UTF-8; surrogates are not characters
+   auto unicode = toml.parse_buffer("s = \"\\u00E9\\u20AC\\U0001F600\"\n");
+   assert(unicode.get_as<std::string>("s") == "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+   toml.parse_buffer("s = \"\\uD800\" # surrogate\n");
+   assert(toml.num_errors() == 1 && toml.get_error(0).code == TomlErrorCode::InvalidEscape);
+}
+
+// test_snapshot
+// Tests saving a document as a snapshot and loading it back
+void test_snapshot() {
+   TomlMappedFile file;
+   assert(file.open("example.toml"));
+   std::string source(file.data(), file.size());
+
+   TomlParser toml;
+   auto doc = toml.parse_buffer(source);
+   doc.set("nested", TomlValue::create_array());
+   assert(TomlSnapshot::save(doc, source, "test.snapshot"));
+
+   TomlSnapshot snapshot;
+   assert(snapshot.open("test.snapshot", source));
+   assert(snapshot.size() == doc.size());
+   assert(snapshot.key(0) == doc.cbegin()->first);
+
+   // Values are read straight from the file
+   assert(snapshot.get("title")->string_value() == "TOML Example");
+   assert(snapshot.get_as<int64_t>("database.connection_max") == 5000);
+   assert(snapshot.get_as<bool>("database.enabled"));
+   assert(snapshot.get("owner.dob")->datetime_value() == doc.get_as<time_t>("owner.dob"));
+   assert(snapshot.get("database.ports")->size() == 3);
+   assert((*snapshot.get("database.ports"))[2].int_value() == 8002);
+   assert((*snapshot.get("clients.data"))[0][1].string_value() == "delta");
+   assert(snapshot.get("nested")->size() == 0);
+   assert(snapshot.get("no.such.key") == nullptr);
+
+   // And can be turned back into the same document
+   assert(toml_diff(doc, snapshot.to_document()).empty());
+
+   // A snapshot of other text is rejected
+   TomlSnapshot stale;
+   assert(!stale.open("test.snapshot", source + "\n"));
+   std::string edited = source;
+   edited[edited.find("5000")] = '6';
+   assert(!stale.open("test.snapshot", edited));
+   assert(!stale.good() && stale.get("title") == nullptr);
+
+   // As is a damaged one
+   std::string image;
+   {
+      std::ifstream in("test.snapshot", std::ios::binary);
+      std::ostringstream contents;
+      contents << in.rdbuf();
+      image = contents.str();
+   }
+   {
+      std::ofstream out("test.snapshot", std::ios::binary | std::ios::trunc);
+      out.write(image.data(), image.size() - 1);
+   }
+   assert(!stale.open("test.snapshot", source));
+
+   snapshot.close();
+   std::remove("test.snapshot");
+}
+
+struct ServerConfig {
+   std::string host;
+   int port;
+   std::uint8_t level;
+   double ratio;
+   bool debug;
+   time_t started;
+   std::vector<std::string> tags;
+   std::vector<std::vector<std::int64_t>> matrix;
+};
+
+struct IntConfig {
+   int i;
+   std::int64_t big;
+   std::uint32_t u;
+   std::int8_t small;
+};
+
+// test_schema
+// Tests parsing straight into a struct, with type checking
+void test_schema() {
+   static const TomlSchema<ServerConfig> schema = TomlSchema<ServerConfig>()
+      .required("server.host", &ServerConfig::host)
+      .required("server.port", &ServerConfig::port)
+      .optional("server.level", &ServerConfig::level)
+      .optional("ratio", &ServerConfig::ratio)
+      .optional("debug", &ServerConfig::debug)
+      .optional_datetime("server.started", &ServerConfig::started)
+      .optional("server.tags", &ServerConfig::tags)
+      .optional("matrix", &ServerConfig::matrix);
+
+   TomlParser toml;
+   ServerConfig config;
+   config.debug = true;
+   assert(schema.parse_buffer(toml,
+      "ratio = 0.75\n"
+      "matrix = [[1, 2], [], [3]]\n"
+      "unknown = [\"ignored\", \"too\"]\n"
+      "[server]\n"
+      "host = \"example.com\"\n"
+      "port = 8080\n"
+      "level = 255\n"
+      "started = 1979-05-27T07:32:00Z\n"
+      "tags = [\"a\", \"b\"]\n", config));
+
+   assert(config.host == "example.com");
+   assert(config.port == 8080);
+   assert(config.level == 255);
+   assert(config.ratio == 0.75);
+   assert(config.debug); // Absent, so left alone
+   assert(config.started == 296638320);
+   assert(config.tags == std::vector<std::string>({ "a", "b" }));
+   assert(config.matrix.size() == 3 && config.matrix[0][1] == 2 && config.matrix[1].empty());
+
+   // Type mismatches, values that don't fit and missing keys are errors
+   assert(!schema.parse_buffer(toml,
+      "ratio = 1\n"
+      "matrix = [1, 2]\n"
+      "[server]\n"
+      "port = \"8080\"\n"
+      "level = 256\n"
+      "tags = [\"a\", 2]\n", config));
+
+   assert(toml.num_errors() == 6);
+   assert(toml.get_error(0).message == "Key 'ratio' should be a float");
+   assert(toml.get_error(0).line_no == 0);
+   assert(toml.get_error(1).message == "Key 'matrix' should be an array, with each element an array, with each element an integer");
+   assert(toml.get_error(2).message == "Key 'server.port' should be an integer from -2147483648 to 2147483647");
+   assert(toml.get_error(2).line_no == 3);
+   assert(toml.get_error(3).message == "Key 'server.level' should be an integer from 0 to 255");
+   assert(toml.get_error(4).message == "Key 'server.tags' should be an array, with each element a string");
+   assert(toml.get_error(5).message == "Missing key 'server.host'");
+   assert(config.level == 255);
+   assert(config.tags == std::vector<std::string>({ "a" })); // The failed element isn't added
+
+   // Missing keys are reported at their table's header
+   TomlError missing = toml.get_error(5);
+   assert(missing.line_no == 2 && missing.column == 1 && missing.offset == 27);
+
+   // Syntax errors are still reported
+   assert(!schema.parse_buffer(toml, "[server]\nhost = \"x\"\nport = 1\nratio = ?\n", config));
+   assert(toml.num_errors() == 1);
+
+   // Negative values and the bounds of each type
+   static const TomlSchema<IntConfig> ints = TomlSchema<IntConfig>()
+      .required("i", &IntConfig::i)
+      .required("big", &IntConfig::big)
+      .required("u", &IntConfig::u)
+      .required("small", &IntConfig::small);
+
+   IntConfig values;
+   assert(ints.parse_buffer(toml, "i = -5\nbig = -7\nu = 0\nsmall = -128\n", values));
+   assert(values.i == -5 && values.big == -7 && values.u == 0 && values.small == -128);
+
+   assert(ints.parse_buffer(toml,
+      "i = -2147483648\nbig = -9223372036854775808\nu = 4294967295\nsmall = 127\n", values));
+   assert(values.i == INT32_MIN && values.big == INT64_MIN && values.u == UINT32_MAX && values.small == 127);
+
+   assert(ints.parse_buffer(toml, "i = 2147483647\nbig = 9223372036854775807\nu = 1\nsmall = 0\n", values));
+   assert(values.i == INT32_MAX && values.big == INT64_MAX);
+
+   assert(!ints.parse_buffer(toml,
+      "i = -2147483649\nbig = 0\nu = -1\nsmall = -129\n", values));
+   assert(toml.num_errors() == 3);
+   assert(toml.get_error(0).message == "Key 'i' should be an integer from -2147483648 to 2147483647");
+   assert(values.i == INT32_MAX && values.u == 1 && values.small == 0);
+
+   assert(!ints.parse_buffer(toml, "i = -9223372036854775808\nbig = 0\nu = 0\nsmall = 128\n", values));
+   assert(toml.num_errors() == 2);
+
+   // Keys outside any table have no position to report
+   assert(!ints.parse_buffer(toml, "i = 1\nbig = 2\nu = 3\n", values));
+   assert(toml.num_errors() == 1 && toml.get_error(0).message == "Missing key 'small'");
+   assert(toml.get_error(0).line_no == -1 && toml.get_error(0).column == -1);
+   assert(toml.get_error(0).offset == TomlError::npos);
+
+   // Table positions outlive a file, which is closed once it is parsed
+   struct GroupConfig {
+      std::string cake, pie;
+   } group;
+   static const TomlSchema<GroupConfig> groups = TomlSchema<GroupConfig>()
+      .required("group.cake", &GroupConfig::cake)
+      .required("group.pie", &GroupConfig::pie);
+
+   TomlParser file("tests.toml");
+   assert(!groups.parse(file, group) && group.cake == "cake");
+   assert(file.num_errors() == 1 && file.get_error(0).message == "Missing key 'group.pie'");
+
+   TomlMappedFile source;
+   assert(source.open("tests.toml"));
+   std::string text(source.data(), source.size());
+   size_t header = text.find("\n[group]\n") + 2;
+   assert(file.get_error(0).offset == header && file.get_error(0).column == 1);
+   assert(file.get_error(0).line_no == std::count(text.begin(), text.begin() + header, '\n'));
+}
+
+// test_typed_arrays
+// Tests whether arrays of numbers and booleans are stored unboxed
+void test_typed_arrays() {
+   TomlParser toml;
+   auto doc = toml.parse_buffer(
+      "ints = [1, -2, 3]\n"
+      "floats = [1.5, 2.5]\n"
+      "bools = [true, false, true]\n"
+      "strings = [\"a\", \"b\"]\n"
+      "nested = [[1, 2], [3.5]]\n"
+      "mixed = [1, 2.5, true]\n"
+      "empty = []\n");
+   assert(toml.success());
+
+   // Read in place
+   auto ints = doc.find<TomlArray>("ints")->int_span();
+   assert(ints.size() == 3 && ints[1] == -2);
+   assert(std::accumulate(ints.begin(), ints.end(), std::int64_t(0)) == 2);
+   assert(doc.find<TomlArray>("floats")->float_span()[1] == 2.5);
+   auto bools = doc.find<TomlArray>("bools")->bool_span();
+   assert(bools.size() == 3 && bools[0] && !bools[1]);
+
+   // Other arrays have no span of the wrong type
+   assert(doc.find<TomlArray>("ints")->float_span().empty());
+   assert(doc.find<TomlArray>("strings")->int_span().empty());
+   assert(doc.find<TomlArray>("empty")->int_span().empty());
+
+   // Elements can still be read as values
+   const TomlArray &array = *doc.find<TomlArray>("ints");
+   assert(array.at(2)->equals(3));
+   assert(doc.get_array_as<int>("ints") == std::vector<int>({ 1, -2, 3 }));
+   assert(doc.get_array_as<double>("floats") == std::vector<double>({ 1.5, 2.5 }));
+   int sum = 0;
+   for (auto it = array.cbegin(); it != array.cend(); ++it) sum += toml_value_cast<int>(*it);
+   assert(sum == 2);
+
+   // Nested and mixed arrays
+   auto nested = doc.find<TomlArray>("nested");
+   assert(static_cast<const TomlArray &>(*nested->at(1)).float_span()[0] == 3.5);
+   auto mixed = doc.find<TomlArray>("mixed");
+   assert(mixed->size() == 3 && mixed->int_span().empty());
+   assert(mixed->at(0)->equals(1) && mixed->at(2)->equals(true));
+   assert(mixed->to_string() == "[1, 2.500000, true]");
+
+   // Adding an element of another type boxes the array
+   TomlArray built;
+   built.add(TomlValue::create_int(7));
+   built.add_int(8);
+   assert(built.int_span().size() == 2);
+   built.add(TomlValue::create_string("nine"));
+   assert(built.int_span().empty() && built.size() == 3);
+   assert(built.at(1)->equals(8) && built.at(2)->equals("nine"));
+
+   TomlWriter writer;
+   assert(writer.write(doc) ==
+      "bools = [true, false, true]\n"
+      "empty = []\n"
+      "floats = [1.5, 2.5]\n"
+      "ints = [1, -2, 3]\n"
+      "mixed = [1, 2.5, true]\n"
+      "nested = [[1, 2], [3.5]]\n"
+      "strings = [\"a\", \"b\"]\n");
+}
+
+// test_parse_stats
+// Tests whether the parser counts what it parses, when built with CTOML_ENABLE_STATS
+void test_parse_stats() {
+   std::string src = "[a]\nname = \"x\\ty\"\nn = 1\nf = 1.5\nb = [true, false]\nd = 1979-05-27T07:32:00Z\n";
+
+   TomlParser toml;
+   toml.parse_buffer(src);
+   toml.parse_buffer(src);
+   const TomlParseStats &stats = toml.stats();
+
+   if (!TomlParseStats::enabled()) {
+      assert(stats.bytes_scanned == 0 && stats.keys == 0 && stats.parse_ns == 0);
+      return;
+   }
+
+   // Each parse starts counting again
+   assert(stats.bytes_scanned == src.size());
+   assert(stats.tables == 1 && stats.keys == 5);
+   assert(stats.strings == 1 && stats.ints == 1 && stats.floats == 1);
+   assert(stats.booleans == 2 && stats.datetimes == 1 && stats.arrays == 1);
+
+   // The booleans are stored unboxed in their array
+   assert(stats.allocations == 5);
+   assert(stats.bytes_allocated > 5 * sizeof(TomlInt));
+   assert(stats.parse_ns > 0 && stats.parse_ns >= stats.string_ns + stats.value_ns + stats.insert_ns);
+
+   TomlParseStats total = stats;
+   total += stats;
+   assert(total.keys == 10);
+}
+
+// A memory resource that keeps track of how much is allocated from it
+class CountingResource : public TomlMemoryResource {
+public:
+   size_t in_use = 0;
+   size_t allocations = 0;
+protected:
+   std::mutex mutex;
+
+   void *do_allocate(size_t size, size_t align) {
+      std::lock_guard<std::mutex> lock(mutex);
+      in_use += size;
+      allocations++;
+      return toml_default_resource()->allocate(size, align);
+   }
+
+   void do_deallocate(void *p, size_t size, size_t align) {
+      std::lock_guard<std::mutex> lock(mutex);
+      in_use -= size;
+      toml_default_resource()->deallocate(p, size, align);
+   }
+};
+
+// test_memory_resource
+// Tests whether documents can be allocated from a caller's memory resource
+void test_memory_resource() {
+   CountingResource resource;
+   std::string src = "name = \"a string that is too long to be stored inline\"\nnumbers = [1, 2, 3]\n"
+      "mixed = [\"a\", 1]\n";
+
+   TomlParser toml;
+   toml.set_memory_resource(&resource);
+   {
+      TomlDocument doc = toml.parse_buffer(src);
+      assert(resource.in_use > 0);
+      assert(doc.get_as<std::string>("name") == "a string that is too long to be stored inline");
+      assert(doc.find<TomlArray>("numbers")->resource() == &resource);
+
+      // Copying a value does not carry the resource over
+      size_t in_use = resource.in_use;
+      TomlArray copy = *doc.find<TomlArray>("numbers");
+      assert(copy.resource() == toml_default_resource() && copy.int_span()[2] == 3);
+      assert(resource.in_use == in_use);
+   }
+   assert(resource.in_use == 0);
+
+   // With an arena, all the values live in the arena's blocks
+   toml.set_use_arena(true);
+   {
+      TomlDocument doc = toml.parse_buffer(src);
+      assert(doc.arena()->upstream() == &resource);
+      assert(doc.find<TomlString>("name")->size() == 45);
+      assert(doc.find<TomlArray>("mixed")->resource() == doc.arena().get());
+   }
+   assert(resource.in_use == 0);
+
+   // Parallel parses draw from the resource on each thread
+   std::string big;
+   for (int g = 0; g < 200; g++) {
+      big += "[group" + std::to_string(g) + "]\n";
+      for (int k = 0; k < 20; k++) big += "key" + std::to_string(k) + " = [\"" + std::to_string(k) + "\"]\n";
+   }
+   toml.set_threads(4);
+   for (int use_arena = 0; use_arena < 2; use_arena++) {
+      toml.set_use_arena(use_arena != 0);
+      TomlDocument doc = toml.parse_buffer(big);
+      assert(toml.success() && doc.size() == 4000 && resource.in_use > 0);
+   }
+   assert(resource.in_use == 0);
+   toml.set_threads(1);
+   toml.set_use_arena(false);
+
+   // Lazy documents decode values into the resource
+   {
+      auto lazy = toml.parse_buffer_lazy(src.data(), src.size());
+      size_t allocations = resource.allocations;
+      assert(lazy.get_as<std::string>("name") == "a string that is too long to be stored inline");
+      assert(resource.allocations > allocations && resource.in_use > 0);
+   }
+   assert(resource.in_use == 0);
+}
+
+// test_error_codes
+// Tests whether errors carry a code and position, and whether parsing stops at the error limit
+void test_error_codes() {
+   TomlParser toml;
+   toml.parse_buffer("a = 1\nb = nope # bad\n  c = \"x\\q\" # bad\nd = 99999999999999999999 # bad\na = 2\n");
+   assert(toml.num_errors() == 4 && !toml.hit_max_errors());
+
+   TomlError error = toml.get_error(0);
+   assert(error.code == TomlErrorCode::InvalidValue && error.message == "\"nope\" is not a valid value");
+   assert(error.line_no == 1 && error.column == 4 && error.offset == 10);
+
+   error = toml.get_error(1);
+   assert(error.code == TomlErrorCode::InvalidEscape && error.message == "Invalid escape character \\q");
+   assert(error.line_no == 2 && error.column == 9);
+
+   assert(toml.get_error(2).code == TomlErrorCode::OutOfRange);
+   assert(toml.get_error(3).code == TomlErrorCode::DuplicateKey && toml.get_error(3).column == 0);
+   assert(toml.get_error(3).message == "The key 'a' has already been used");
+   assert(toml.get_error(3).line_no == 4);
+
+   // A duplicate key's line agrees with its offset, whether or not the value ends the line
+   for (auto src : { "a = 1\na = 2\n", "a = 1\na = 2", "a = 1\na = [\n2]\n", "a = 1\n\n  a = 2 # again\n" }) {
+      toml.parse_buffer(src);
+      TomlError dup = toml.get_error(0);
+      assert(toml.num_errors() == 1 && dup.code == TomlErrorCode::DuplicateKey);
+      assert(dup.line_no == std::count(src, src + dup.offset, '\n'));
+   }
+
+   // A limit stops the parse early, serially or on several threads
+   std::string src;
+   for (int i = 0; i < 100000; i++) src += "key" + std::to_string(i) + " = bad\n";
+
+   toml.set_max_errors(3);
+   toml.parse_buffer(src);
+   assert(toml.num_errors() == 3 && toml.hit_max_errors());
+   assert(toml.get_error(2).offset == src.find("key4 ") + 7);
+
+   // Reaching the limit on the last entry doesn't cut anything short
+   toml.parse_buffer("a = bad\nb = 1\nc = bad # comment\n\n# trailing comment\n");
+   assert(toml.num_errors() == 2 && !toml.hit_max_errors());
+   toml.parse_buffer("a = bad # bad\nb = bad # bad\nc = bad");
+   assert(toml.num_errors() == 3 && !toml.hit_max_errors());
+   toml.parse_buffer("a = bad # bad\nb = bad # bad\nc = bad # bad\nd = 1\n");
+   assert(toml.num_errors() == 3 && toml.hit_max_errors());
+
+   toml.set_max_errors(1);
+   toml.set_threads(4);
+   toml.parse_buffer(src);
+   assert(toml.num_errors() == 1 && toml.get_error(0).offset == 7);
+}
+
+// test_parse_limits
+// Tests whether sources that break a limit are rejected, and parsing stops there
+void test_parse_limits() {
+   TomlParser toml;
+
+   // Arrays can't nest deeper than the default limit, however deep the source goes
+   toml.parse_buffer("a = " + std::string(100000, '[') + "\n");
+   assert(toml.num_errors() == 1 && toml.get_error(0).code == TomlErrorCode::LimitExceeded);
+   assert(toml.get_error(0).message == "The document exceeds max_depth of 1000");
+   assert(toml.parse_buffer_lazy(("a = " + std::string(100000, '[') + "\n").c_str(), 100005).size() == 0);
+
+   TomlParseLimits limits;
+   limits.max_bytes = 20;
+   toml.set_limits(limits);
+   toml.parse_buffer("a = \"a little over twenty bytes\"\n");
+   assert(toml.num_errors() == 1 && toml.get_error(0).message == "The document exceeds max_bytes of 20");
+
+   limits = TomlParseLimits();
+   limits.max_string_length = 4;
+   limits.max_array_length = 3;
+   toml.set_limits(limits);
+   assert(toml.parse_buffer("a = \"abcd\"\nb = \"a\\tcd\"\nc = [1, 2, 3]\n").size() == 3);
+   toml.parse_buffer("a = \"abcde\"\nb = 1 = 2\n");
+   assert(toml.num_errors() == 1 && toml.get_error(0).column == 5);
+   toml.parse_buffer("a = \"ab\\t\\tcd\"\n");
+   assert(toml.num_errors() == 1);
+   toml.parse_buffer("a = [[1, 2], [3, 4, 5, 6]]\n");
+   assert(toml.num_errors() == 1 && toml.get_error(0).message == "The document exceeds max_array_length of 3");
+
+   // The number of keys is checked across every section of a parallel parse
+   std::string src;
+   for (int g = 0; g < 400; g++) {
+      src += "[group" + std::to_string(g) + "]\n";
+      for (int k = 0; k < 20; k++) src += "key" + std::to_string(k) + " = " + std::to_string(k) + "\n";
+   }
+
+   limits = TomlParseLimits();
+   limits.max_keys = 5000;
+   toml.set_limits(limits);
+   toml.parse_buffer(src);
+   TomlError serial = toml.get_error(0);
+   assert(toml.num_errors() == 1 && serial.message == "The document exceeds max_keys of 5000");
+
+   toml.set_threads(4);
+   toml.parse_buffer(src);
+   assert(toml.num_errors() == 1 && toml.get_error(0).offset == serial.offset);
+   assert(toml.get_error(0).line_no == serial.line_no);
+   toml.set_threads(1);
+
+   // Sections reused by a reparse count against the limits too
+   std::string v1 = "[a]\nx = \"long string\"\ny = [[1]]\n[b]\nz = 1\n";
+   std::string v2 = "[a]\nx = \"long string\"\ny = [[1]]\n[b]\nz = 2\n";
+   TomlDiff diff;
+   toml.set_limits(TomlParseLimits());
+   auto previous = toml.reparse_buffer(TomlDocument(), v1.data(), v1.size(), diff);
+   assert(toml.success());
+
+   limits = TomlParseLimits();
+   limits.max_keys = 2;
+   toml.set_limits(limits);
+   toml.reparse_buffer(previous, v2.data(), v2.size(), diff);
+   assert(toml.num_errors() == 1 && toml.get_error(0).message == "The document exceeds max_keys of 2");
+
+   limits = TomlParseLimits();
+   limits.max_string_length = 4;
+   toml.set_limits(limits);
+   toml.reparse_buffer(previous, v2.data(), v2.size(), diff);
+   assert(toml.num_errors() == 1 && toml.get_error(0).line_no == 1);
+
+   limits = TomlParseLimits();
+   limits.max_depth = 1;
+   toml.set_limits(limits);
+   toml.reparse_buffer(previous, v2.data(), v2.size(), diff);
+   assert(toml.num_errors() == 1 && toml.get_error(0).message == "The document exceeds max_depth of 1");
+
+   // Within the limits, unchanged sections are still shared
+   limits.max_depth = 2;
+   toml.set_limits(limits);
+   auto next = toml.reparse_buffer(previous, v2.data(), v2.size(), diff);
+   assert(toml.success() && next.find("a.x") == previous.find("a.x"));
+}
+
 // test_parse_strings
 // test whether strings are parsed correctly, along with escape characters
 void test_parse_strings() {
@@ -48,10 +944,376 @@ void test_parse_file() {
    assert(toml.success());
 }
 
+// test_parse_buffer
+// Tests whether documents can be parsed from an in-memory buffer
+void test_parse_buffer() {
+   TomlParser toml;
+   auto doc = toml.parse_buffer("\nanswer = 42\n[group]\nname = \"buffer\"");
+
+   assert(toml.success());
+   assert(doc.get_as<int>("answer") == 42);
+   assert(doc.get_as<std::string>("group.name") == "buffer");
+
+   // Errors should report the right line
+   toml.parse_buffer("a = 1\nb = ? # not a value\n");
+   assert(!toml.success());
+   assert(toml.get_error(0).line_no == 1);
+}
+
+// test_parse_arena
+// Tests whether documents parsed into an arena behave like heap allocated ones
+void test_parse_arena() {
+   TomlParser toml("tests.toml");
+   toml.set_use_arena(true);
+   auto doc = toml.parse();
+
+   assert(toml.success());
+   assert(doc.arena() != nullptr);
+   assert(doc.get_as<std::string>("group.subgroup.apples") == "apples");
+   assert(doc.get_array_as<int>("arrays.int-array").size() == 3);
+
+   // Copies share the arena
+   TomlDocument copy = doc;
+   assert(copy.get("test-string")->equals("I'm a string. \"You can quote me\". "
+      "Tab \t newline \n you get it."));
+
+   // Values keep the arena alive after the documents are gone
+   std::weak_ptr<TomlArena> arena = doc.arena();
+   auto value = doc.get("group.subgroup.apples");
+   auto strings = doc.get("arrays.str-array");
+   auto element = static_cast<const TomlArray &>(*strings).at(1);
+   doc = TomlDocument();
+   copy = TomlDocument();
+   strings = nullptr;
+
+   assert(!arena.expired());
+   assert(value->equals("apples"));
+   assert(element->equals("there"));
+
+   value = nullptr;
+   element = nullptr;
+   assert(arena.expired());
+}
+
+// test_arena_reads
+// Tests whether reading an arena document, from several threads at once,
+// leaves the arena alone
+void test_arena_reads() {
+   TomlParser toml;
+   toml.set_use_arena(true);
+   auto doc = toml.parse_buffer("ints = [1, 2, 3]\nfloats = [0.5, 1.5]\nflags = [true, false]\n"
+      "mixed = [1, \"two\", [3, 4]]\n");
+   assert(toml.success());
+
+   size_t used = doc.arena()->bytes_allocated();
+   std::vector<std::thread> readers;
+   for (int t = 0; t < 4; t++) {
+      readers.push_back(std::thread([&] {
+         for (int i = 0; i < 10000; i++) {
+            const TomlArray &ints = *doc.find<TomlArray>("ints");
+            assert(ints.at(i % 3)->equals(i % 3 + 1));
+            assert(toml_value_cast<double>(*doc.find<TomlArray>("floats")->at(1)) == 1.5);
+            assert(doc.find<TomlArray>("flags")->at(0)->equals(true));
+
+            std::int64_t sum = 0;
+            for (auto it = ints.cbegin(); it != ints.cend(); ++it) sum += toml_value_cast<std::int64_t>(*it);
+            assert(sum == 6);
+            assert(doc.find("mixed")->to_string() == "[1, two, [3, 4]]");
+         }
+      }));
+   }
+   for (auto &reader : readers) reader.join();
+
+   assert(doc.arena()->bytes_allocated() == used);
+   assert(toml_values_equal(*doc.find("mixed"), *toml.parse_buffer("a = [1, \"two\", [3, 4]]\n").find("a")));
+   assert(!toml_values_equal(*doc.find("ints"), *doc.find("mixed")));
+}
+
+// test_compact_document
+// Tests whether a compact document holds the same values as the parsed one
+void test_compact_document() {
+   TomlParser toml("tests.toml");
+   auto doc = toml.parse();
+   TomlCompactDocument compact(doc);
+
+   assert(compact.size() == doc.size());
+   assert(compact.get_as<std::int64_t>("test-large-int") == 1152921504606846976LL);
+   assert(compact.get_as<std::string>("group.cake") == "cake");
+   assert(compact.get("test-float1")->float_value() == 1.0);
+   assert(compact.get("test-float1")->int_value() == 0);
+   assert(compact.get("missing") == nullptr);
+
+   const TomlCompactValue &array = *compact.get("arrays.str-array");
+   assert(array.type() == TomlType::Array && array.size() == 3);
+   assert(array[1].string_value() == "there");
+
+   // Parsed directly, without a TomlDocument
+   TomlCompactDocument parsed;
+   TomlParser again("tests.toml");
+   assert(parsed.parse(again));
+   assert(parsed.size() == doc.size());
+   for (auto it = doc.cbegin(); it != doc.cend(); ++it) {
+      const TomlCompactValue *value = parsed.get(it->first);
+      assert(value && value->type() == it->second->type());
+   }
+   assert(parsed.get_as<std::string>("group.subgroup.apples") == "apples");
+   assert(parsed.get_as<time_t>("test-date") == doc.get_as<time_t>("test-date"));
+   assert(parsed.get("arrays.int-array")->size() == 3);
+
+   assert(parsed.parse_buffer(toml, "a = [[1, 2], [\"x\"], []]\n[b]\nc = 1.5\n"));
+   const TomlCompactValue &nested = *parsed.get("a");
+   assert(parsed.size() == 2 && nested.size() == 3);
+   assert(nested[0][1].int_value() == 2 && nested[1][0].string_value() == "x" && nested[2].size() == 0);
+   assert(parsed.get("b.c")->float_value() == 1.5);
+
+   // Keys defined twice, or used as both a value and a key group, are errors,
+   // just as they are for a TomlDocument
+   assert(!parsed.parse_buffer(toml, "a = 1\na = 2\n"));
+   assert(toml.get_error(0).code == TomlErrorCode::DuplicateKey);
+   assert(toml.get_error(0).line_no == 1 && toml.get_error(0).offset == 6);
+   assert(parsed.get_as<int>("a") == 1);
+
+   for (auto src : { "a = 1\n[a]\nb = 2\n", "[a.b]\nc = 1\n[a]\nb = 2\n", "[a]\nb = 1\nb.c = 2\n",
+      "[a.b]\n[a]\nb = 1\n" }) {
+      assert(!parsed.parse_buffer(toml, src));
+      TomlParser full;
+      full.parse_buffer(src);
+      assert(toml.num_errors() == 1 && full.num_errors() == 1);
+      assert(toml.get_error(0).message == full.get_error(0).message);
+      assert(toml.get_error(0).line_no == full.get_error(0).line_no);
+   }
+   assert(parsed.parse_buffer(toml, "[a]\nb.c = 1\nb.d = 2\n[a.e]\nf = 3\n"));
+}
+
+// test_key_tables
+// Tests whether key groups can be enumerated and whether key clashes are caught
+void test_key_tables() {
+   TomlParser toml("tests.toml");
+   auto doc = toml.parse();
+
+   const TomlTable *group = doc.get_table("group");
+   assert(group && group->size() == 2);
+   assert(group->begin()->name == "cake" && !group->begin()->is_table());
+   assert(doc.slot(group->begin()->slot).first == "group.cake");
+   assert(group->find("subgroup", 8)->is_table());
+   assert(doc.get_table("empty-group")->size() == 0);
+   assert(!doc.is_key("group"));
+
+   // A value can't be used as a key group and vice versa
+   assert(!doc.set("group", TomlValue::create_int(1)));
+   assert(!doc.insert("group.cake.size", TomlValue::create_int(1)));
+   assert(doc.set("group.cake", TomlValue::create_string("pie")));
+   assert(doc.get_as<std::string>("group.cake") == "pie");
+
+   toml.parse_buffer("a = 1\n[a.b]\nc = 2 # a is not a group\n");
+   assert(toml.num_errors() == 1);
+   toml.parse_buffer("[a.b]\nc = 1\n[a]\nb = 2 # a.b is a group\n");
+   assert(toml.num_errors() == 1);
+   toml.parse_buffer("[a]\nb.c = 1\nb.d = 2\n");
+   assert(toml.success());
+
+   // A duplicate key only loses its own line, so the next one is still checked
+   toml.parse_buffer("a = 1\na = 2\nc = bad\n");
+   assert(toml.num_errors() == 2 && toml.get_error(1).code == TomlErrorCode::InvalidValue);
+   toml.parse_buffer("a = 1\na = 2\na = 3\nb = 4\n");
+   assert(toml.num_errors() == 2 && toml.get_error(1).code == TomlErrorCode::DuplicateKey);
+   toml.parse_buffer("a = 1\na = [2,\n  3] # comment\nb = bad\n");
+   assert(toml.num_errors() == 2);
+
+   std::string src = "a = 1\na = 2\na = 3\n";
+   toml.parse_buffer_lazy(src.data(), src.size());
+   assert(toml.num_errors() == 2);
+}
+
+// test_find
+// Tests key lookups that return raw pointers
+void test_find() {
+   TomlParser toml("tests.toml");
+   auto doc = toml.parse();
+
+   const TomlValue *value = doc.find("group.subgroup.apples");
+   assert(value && value->equals("apples"));
+   assert(value == doc.get(std::string("group.subgroup.apples")).get());
+   assert(doc.find("group.subgroup") == nullptr);
+   assert(doc.find("group.subgroup.apples.x") == nullptr);
+   assert(doc.find<TomlArray>("arrays.int-array")->size() == 3);
+
+   // Missing keys read as default values
+   assert(doc.get_as<int>("missing") == 0);
+   assert(doc.get_array_as<int>("test-positive-int").empty());
+   assert(doc.get_array_as<std::string>("arrays.str-array")[2] == "!");
+}
+
+// test_key_handles
+// Tests reading keys through resolved handles and compile-time hashed keys
+void test_key_handles() {
+   static constexpr TomlKey kApples("group.subgroup.apples");
+   static_assert(kApples.hash == toml_key_hash("group.subgroup.apples", 21), "hash is not constexpr");
+   assert(kApples.hash == TomlTable::hash("group.subgroup.apples", 21));
+
+   TomlParser toml("tests.toml");
+   auto doc = toml.parse();
+
+   TomlKeyHandle cake = doc.resolve("group.cake");
+   assert(cake.valid() && doc.get_as<std::string>(cake) == "cake");
+   assert(!doc.resolve("group.pie").valid());
+   assert(doc.find(doc.resolve("group.pie")) == nullptr);
+
+   // Handles survive the value being replaced
+   doc.set("group.cake", TomlValue::create_string("pie"));
+   assert(doc.get_as<std::string>(cake) == "pie");
+
+   assert(doc.get_as<std::string>(kApples) == "apples");
+   assert(doc.resolve(kApples).slot == doc.resolve("group.subgroup.apples").slot);
+   assert(doc.find(TomlKey("group.subgroup")) == nullptr);
+}
+
+// test_parse_all
+// Tests whether many files can be parsed concurrently
+void test_parse_all() {
+   std::vector<std::string> files;
+   for (int i = 0; i < 16; i++) {
+      files.push_back(i % 2 ? "tests.toml" : "example.toml");
+   }
+   files.push_back("missing.toml");
+
+   TomlParser toml;
+   auto results = toml.parse_all(files, 4);
+
+   assert(results.size() == files.size());
+   for (size_t i = 0; i + 1 < results.size(); i++) {
+      assert(results[i].filename == files[i]);
+      assert(results[i].success());
+   }
+   assert(results[1].document.get_as<std::string>("group.cake") == "cake");
+   assert(!results.back().good && !results.back().success());
+}
+
+// test_parse_threads
+// Tests whether large documents parsed on several threads match a serial parse
+void test_parse_threads() {
+   std::string src = "title = \"[not a group]\"\n";
+   for (int g = 0; g < 400; g++) {
+      src += "[group" + std::to_string(g) + "]\n";
+      src += "name = \"line one\\n[fake.group]\\\" # still a string\"\n";
+      src += "nested = [\n[1, 2],\n  [3, 4] # comment ]\n]\n";
+      for (int k = 0; k < 20; k++) {
+         src += "key" + std::to_string(k) + " = " + std::to_string(g * k) + "\n";
+      }
+   }
+
+   TomlParser serial, parallel;
+   parallel.set_threads(4);
+
+   auto expected = serial.parse_buffer(src);
+   auto doc = parallel.parse_buffer(src);
+   assert(serial.success() && parallel.success());
+   assert(doc.size() == 400 * 22 + 1);
+   assert(same_document(doc, expected));
+
+   // Duplicates across sections are reported on the right line
+   std::string dup = src + "[group7]\nkey3 = 1 # again\n";
+   serial.parse_buffer(dup);
+   parallel.parse_buffer(dup);
+   assert(parallel.num_errors() == 1 && serial.num_errors() == 1);
+   assert(parallel.get_error(0).line_no == serial.get_error(0).line_no);
+   assert(parallel.get_error(0).message == serial.get_error(0).message);
+
+   // Duplicates in the middle are recovered from exactly as in a serial parse
+   std::string dups = src;
+   dups.insert(dups.find("[group200]\n") + 11, "key0 = 1\nkey0 = 2\nkey1 = 3\nextra = 4\n");
+   dups += "[group9]\nkey2 = 5\n";
+   serial.parse_buffer(dups);
+   parallel.parse_buffer(dups);
+   assert(serial.num_errors() > 1 && parallel.num_errors() == serial.num_errors());
+   for (size_t i = 0; i < serial.num_errors(); i++) {
+      assert(parallel.get_error(i).message == serial.get_error(i).message);
+      assert(parallel.get_error(i).line_no == serial.get_error(i).line_no);
+      assert(parallel.get_error(i).offset == serial.get_error(i).offset);
+   }
+
+   // As are syntax errors
+   std::string bad = src + "[last]\nvalue = ? # bad\n";
+   serial.parse_buffer(bad);
+   parallel.parse_buffer(bad);
+   assert(parallel.num_errors() == 1);
+   assert(parallel.get_error(0).line_no == serial.get_error(0).line_no);
+}
+
+// test_scan
+// Tests whether bulk scanning finds the same characters as a plain loop
+void test_scan() {
+   // Place the interesting character at every offset, across vector widths
+   for (size_t len = 0; len < 80; len++) {
+      for (size_t at = 0; at <= len; at++) {
+         std::string buf(len, 'a');
+         if (at < len) buf[at] = '\\';
+         const char *begin = buf.data(), *end = begin + len;
+
+         assert(toml_find_quote_or_escape(begin, end) == begin + at);
+         assert(toml_find_structural(begin, end) == begin + at);
+
+         std::string spaces(len, ' ');
+         if (at < len) spaces[at] = 'x';
+         assert(toml_skip_spaces(spaces.data(), spaces.data() + len) == spaces.data() + at);
+      }
+   }
+
+   std::string mixed = "  \t\r\n\v\f  \n\n  x = \"text\"";
+   assert(*toml_skip_spaces(mixed.data(), mixed.data() + mixed.size()) == 'x');
+   assert(toml_count_newlines(mixed.data(), mixed.data() + mixed.size()) == 3);
+
+   // Line numbers should survive long comments and strings
+   std::string src = "# " + std::string(100, '-') + "\n\n";
+   src += "s = \"" + std::string(70, 's') + "\\t" + std::string(40, 's') + "\" # done\n";
+   src += "      \n       bad = ? # comment\n";
+
+   TomlParser toml;
+   auto doc = toml.parse_buffer(src);
+   assert(toml.num_errors() == 1);
+   assert(toml.get_error(0).line_no == 4);
+   assert(doc.get_as<std::string>("s") == std::string(70, 's') + "\t" + std::string(40, 's'));
+
+   // Text hashes are XXH64 with a zero seed, and change with any byte of the text
+   assert(toml_hash_bytes("", 0) == 0xEF46DB3751D8E999ULL);
+   assert(toml_hash_bytes("abc", 3) == 0x44BC2CF5AD770999ULL);
+   std::string text = "Nobody inspects the spammish repetition";
+   assert(toml_hash_bytes(text.data(), text.size()) == 0xFBCEA83C8A378BF1ULL);
+   for (size_t at = 0; at < text.size(); at++) {
+      std::string changed = text;
+      changed[at] ^= 1;
+      assert(toml_hash_bytes(changed.data(), changed.size()) != toml_hash_bytes(text.data(), text.size()));
+   }
+}
+
 int main(int argc, char *argv[]) {
    test_parse_file();
+   test_parse_buffer();
+   test_parse_arena();
+   test_arena_reads();
+   test_compact_document();
+   test_key_tables();
+   test_find();
+   test_key_handles();
+   test_parse_all();
+   test_parse_threads();
+   test_scan();
+   test_parse_events();
+   test_parse_lazy();
+   test_reparse();
+   test_shared_document();
+   test_write();
+   test_snapshot();
+   test_schema();
+   test_typed_arrays();
+   test_parse_stats();
+   test_memory_resource();
+   test_error_codes();
+   test_parse_limits();
    test_parse_strings();
    test_parse_ints();
+   test_parse_numbers();
+   test_parse_datetimes();
    test_key_groups();
 
    std::cout << "All tests passed!" << std::endl;